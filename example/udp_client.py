@@ -10,21 +10,16 @@ with UDPInput((640, 480), "cpu", 4301) as stream:
 
     # In this case, we read() every 500ms
     interval = 0.5
-    t_0 = time.time()
 
     out = []
     # Loop forever
     while True:
-        # When 500 ms passed...
-        if t_0 + interval <= time.time():
+        # Block until 500 ms passed, without spinning on the CPU.
+        # The frame is read early once it holds a million events
+        t_0 = time.time()
+        frame = stream.read(min_events=1_000_000, timeout=interval)
+        out.append(frame)
 
-            # Grab a tensor of the events arriving during the past 500ms
-            frame = stream.read()
-            out.append(frame)
-
-            # Reset the time so we're again counting to 500ms
-            t_0 = time.time()
-
-            # Sum the incoming events and print along the timestamp
-            time_string = datetime.datetime.fromtimestamp(t_0).time()
-            print(f"Frame at {time_string} with {frame.sum()} events")
+        # Sum the incoming events and print along the timestamp
+        time_string = datetime.datetime.fromtimestamp(t_0).time()
+        print(f"Frame at {time_string} with {frame.sum()} events")
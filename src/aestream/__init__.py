@@ -7,8 +7,8 @@ import logging
 from importlib.metadata import version, PackageNotFoundError
 
 # Import AEStream modules
-from aestream.aestream_ext import Backend, Camera, Event, drivers
-from aestream._input import FileInput, UDPInput
+from aestream.aestream_ext import Backend, Camera, Event, FrameMode, Layout, Pooling, drivers
+from aestream._input import FileInput, SharedMemoryInput, TCPInput, UDPInput
 
 
 try:
@@ -42,5 +42,5 @@ else:
 
 del logging
 
-__all__ = ["Backend", "Camera", "drivers", "Event", "FileInput", "UDPInput"] + modules
+__all__ = ["Backend", "Camera", "drivers", "Event", "FrameMode", "Layout", "Pooling", "FileInput", "SharedMemoryInput", "TCPInput", "UDPInput"] + modules
 del modules
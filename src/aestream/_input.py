@@ -32,24 +32,198 @@ def _convert_parameter_to_backend(backend: Union[ext.Backend, str]):
         raise TypeError("backend must be either ext.Backend or str")
 
 
-def _read_backend(obj: Any, backend: ext.Backend, population: Optional[Any]):
+def _convert_parameter_to_mode(mode: Union[ext.FrameMode, str]):
+    if isinstance(mode, ext.FrameMode):
+        return mode
+    elif isinstance(mode, str):
+        return getattr(ext.FrameMode, mode.title())
+    else:
+        raise TypeError("mode must be either ext.FrameMode or str")
+
+
+def _convert_parameter_to_layout(layout: Union[ext.Layout, str]):
+    if isinstance(layout, ext.Layout):
+        return layout
+    elif isinstance(layout, str):
+        return getattr(ext.Layout, layout.upper())
+    else:
+        raise TypeError("layout must be either ext.Layout or str")
+
+
+def _convert_parameter_to_pooling(pooling: Union[ext.Pooling, str]):
+    if isinstance(pooling, ext.Pooling):
+        return pooling
+    elif isinstance(pooling, str):
+        return getattr(ext.Pooling, pooling.title())
+    else:
+        raise TypeError("pooling must be either ext.Pooling or str")
+
+
+_DTYPES = {
+    "float32": ext.DType.Float32,
+    "uint8": ext.DType.UInt8,
+    "uint16": ext.DType.UInt16,
+    "int16": ext.DType.Int16,
+    "bool": ext.DType.Bool,
+}
+
+
+def _convert_parameter_to_dtype(dtype: Union[ext.DType, str, np.dtype, type]):
+    if isinstance(dtype, ext.DType):
+        return dtype
+    name = np.dtype(dtype).name
+    if name not in _DTYPES:
+        raise TypeError(f"dtype must be one of {', '.join(_DTYPES)}, not {name}")
+    return _DTYPES[name]
+
+
+def _frame_options(kwargs: dict):
+    """
+    Moves the frame options among the keyword arguments of an input into the
+    FrameOptions the extension expects.
+    """
+    options = kwargs.pop("options", None) or ext.FrameOptions()
+    if "mode" in kwargs:
+        options.mode = _convert_parameter_to_mode(kwargs.pop("mode"))
+    if "dtype" in kwargs:
+        options.dtype = _convert_parameter_to_dtype(kwargs.pop("dtype"))
+    if "layout" in kwargs:
+        options.layout = _convert_parameter_to_layout(kwargs.pop("layout"))
+    if "pooling" in kwargs:
+        options.pooling = _convert_parameter_to_pooling(kwargs.pop("pooling"))
+    if "roi" in kwargs:
+        (
+            options.roi_x,
+            options.roi_y,
+            options.roi_width,
+            options.roi_height,
+        ) = kwargs.pop("roi")
+    for name in (
+        "bins",
+        "window_us",
+        "tau_us",
+        "record_events",
+        "channels_last",
+        "flip_x",
+        "flip_y",
+        "rotation",
+        "downsample",
+    ):
+        if name in kwargs:
+            setattr(options, name, kwargs.pop(name))
+    kwargs["options"] = options
+    return kwargs
+
+
+def _read_backend(
+    obj: Any,
+    backend: ext.Backend,
+    population: Optional[Any],
+    min_events: int = 0,
+    until_timestamp: Optional[int] = None,
+    timeout: Optional[float] = None,
+):
     backend = _convert_parameter_to_backend(backend)
+    if min_events > 0 or until_timestamp is not None:
+        obj.wait(min_events, until_timestamp, timeout)
     if backend == ext.Backend.GeNN:
         obj.read_genn(population.extra_global_params["input"].view)
         population.push_extra_global_param_to_device("input")
         return population.extra_global_params["input"].view
-    elif backend == ext.Backend.Jax:
-        t = obj.read_buffer()
+    else:
+        return _to_backend(obj.read_buffer(), backend)
+
+
+def _to_backend(t: ext.BufferPointer, backend: ext.Backend):
+    if backend == ext.Backend.Jax:
         return t.to_jax()
     elif backend == ext.Backend.Torch:
-        t = obj.read_buffer()
         return t.to_torch()
     else:
-        t = obj.read_buffer()
         return t.to_numpy()
 
 
-class FileInput(ext.FileInput):
+def _integer_column(column: np.ndarray, dtype: np.dtype):
+    # Signed columns of the same width are reinterpreted as unsigned. Other
+    # arrays pass through unchanged, for the binding to reject.
+    dtype = np.dtype(dtype)
+    if column.dtype.kind == "i" and column.dtype.itemsize == dtype.itemsize:
+        return column.view(dtype)
+    return column
+
+
+class FrameInput:
+    """
+    Accumulates the events an input receives into frames, which read returns.
+    Every input takes these keyword arguments, besides its own.
+
+    Parameters:
+        mode (str): How events are accumulated into frames: "count" (events
+            per pixel), "polarity" (events per pixel and polarity in a
+            (2, X, Y) frame), "signed" (+1 for positive and -1 for negative
+            events), "binary" (1 for pixels with any event), "voxel" (a
+            (bins, 2, X, Y) grid of events weighted bilinearly by their time within
+            the window) or "surface" (a time surface exp(-(t - t_last) / tau_us)
+            of the last event at each pixel). Defaults to "count".
+        bins (int): Number of time bins in voxel mode. Defaults to 1.
+        window_us (int): Event time covered by a voxel frame in microseconds,
+            starting at the first event of the frame. Events past the window
+            move the frame on to the window holding them, clearing it.
+            Required in voxel mode.
+        tau_us (float): Decay time constant of time surfaces in microseconds.
+            Required in surface mode.
+        dtype (np.dtype): Element type of the frames: float32 (default), uint8,
+            uint16, int16 or bool. Integer frames saturate, and voxel grids, time
+            surfaces and CUDA frames require float32.
+        record_events (bool): Whether to keep the received events for
+            read_events and read_sparse. Defaults to False.
+        layout (str): Order of the spatial frame dimensions: "wh" for (X, Y)
+            (default) or "hw" for row-major (Y, X) frames.
+        channels_last (bool): Whether polarity channels come last, as in (X, Y, 2).
+            Defaults to False.
+        flip_x (bool): Whether to mirror the x coordinates. Defaults to False.
+        flip_y (bool): Whether to mirror the y coordinates. Defaults to False.
+        rotation (int): Clockwise rotation of the frames in degrees: 0 (default),
+            90, 180 or 270.
+        roi (tuple): Region of the sensor to keep, as (x, y, width, height) in
+            pixels. Events outside it are dropped. A width or height of 0 reaches
+            to the edge of the sensor. Defaults to the whole sensor.
+        downsample (int): Integer factor that the width and height of the region
+            shrink by. Defaults to 1.
+        pooling (str): How downsampled pixels combine their events: "sum"
+            (default) counts them all, while "any" marks that any arrived. Voxel
+            grids and time surfaces always sum.
+    """
+
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **_frame_options(kwargs))
+
+    def read(
+        self,
+        backend: ext.Backend = ext.Backend.Numpy,
+        min_events: int = 0,
+        until_timestamp: Optional[int] = None,
+        timeout: Optional[float] = None,
+    ):
+        """
+        Reads the events since the last read as a frame.
+
+        Parameters:
+            backend (str): Backend of the frame. Defaults to "numpy".
+            min_events (int): Blocks until the frame holds at least this many
+                events. Defaults to 0.
+            until_timestamp (int): Blocks until an event at or after this time in
+                microseconds arrived. Defaults to None.
+            timeout (float): Seconds to block at most, after which the frame is
+                read regardless. Defaults to None, which blocks until the events
+                arrive or the stream ends.
+        """
+        return _read_backend(
+            self, backend, None, min_events, until_timestamp, timeout
+        )
+
+
+class FileInput(FrameInput, ext.FileInput):
     """
     Reads events from a file.
 
@@ -60,17 +234,151 @@ class FileInput(ext.FileInput):
         ignore_time (bool): Whether to ignore the timestamps for the events when
             streaming. If set to True, the events will be streamed as fast as possible.
             Defaults to False.
+        speed (float): Playback speed relative to the recording when timestamps
+            are not ignored, from 0.1 to 100. Defaults to 1.
+        **options: How events are accumulated into frames, as described in
+            FrameInput.
     """
 
     def load(self):
         buffer = self.load_all()
         return np.frombuffer(buffer.data, NUMPY_EVENT_DTYPE)
 
-    def read(self, backend: ext.Backend = ext.Backend.Numpy):
-        return _read_backend(self, backend, None)
+    def read_into(self, events: np.ndarray) -> int:
+        """
+        Decodes the next events directly into a preallocated array.
+
+        Parameters:
+            events (np.ndarray): Contiguous array of dtype NUMPY_EVENT_DTYPE.
+
+        Returns:
+            The number of events written, which is less than len(events) only
+            at the end of the file.
+        """
+        if events.dtype != NUMPY_EVENT_DTYPE:
+            raise TypeError(
+                f"Events must be of dtype NUMPY_EVENT_DTYPE, not {events.dtype}"
+            )
+        return self.read_into_buffer(events.view(np.uint8))
+
+    def read_columns_into(
+        self,
+        timestamp: np.ndarray,
+        x: np.ndarray,
+        y: np.ndarray,
+        polarity: np.ndarray,
+    ) -> int:
+        """
+        Decodes the next events directly into preallocated column arrays.
 
+        Parameters:
+            timestamp (np.ndarray): Contiguous 64-bit integer array.
+            x (np.ndarray): Contiguous 16-bit integer array.
+            y (np.ndarray): Contiguous 16-bit integer array.
+            polarity (np.ndarray): Contiguous boolean array.
 
-class UDPInput(ext.UDPInput):
+        Returns:
+            The number of events written.
+        """
+        return self.read_columns_into_buffer(
+            _integer_column(timestamp, np.uint64),
+            _integer_column(x, np.uint16),
+            _integer_column(y, np.uint16),
+            polarity,
+        )
+
+    def frames(
+        self,
+        window_us: int,
+        stride_us: Optional[int] = None,
+        backend: ext.Backend = ext.Backend.Numpy,
+        prefetch: int = 4,
+    ):
+        """
+        Iterates over frames of the file cut by event time, so the same file
+        always gives the same frames. Frames are decoded and accumulated on a
+        background thread while the previous ones are processed. Every
+        iteration reads the file from the start, apart from streams and load.
+
+        Parameters:
+            window_us (int): Event time covered by every frame in microseconds,
+                counted from the first event.
+            stride_us (int): Event time between the starts of two frames in
+                microseconds. Shorter strides than windows give overlapping
+                frames. Defaults to window_us.
+            backend (str): Backend of the frames. Defaults to "numpy".
+            prefetch (int): Number of frames accumulated ahead. Defaults to 4.
+        """
+        backend = _convert_parameter_to_backend(backend)
+        if backend == ext.Backend.GeNN:
+            raise ValueError("Frames cannot be iterated with GeNN")
+        for frame in self.frame_iterator(window_us, stride_us, prefetch):
+            yield _to_backend(frame, backend)
+
+    def frames_batched(
+        self,
+        window_us: int,
+        batch: int = 32,
+        stride_us: Optional[int] = None,
+        backend: ext.Backend = ext.Backend.Numpy,
+    ):
+        """
+        Iterates over batches of frames of the file cut by event time, like
+        frames, but fills every batch into one (batch, ...) array. The frames
+        of a batch are accumulated in parallel.
+
+        Parameters:
+            window_us (int): Event time covered by every frame in microseconds,
+                counted from the first event.
+            batch (int): Number of frames in a batch. The last batch holds
+                fewer frames if the file ends first. Defaults to 32.
+            stride_us (int): Event time between the starts of two frames in
+                microseconds. Defaults to window_us.
+            backend (str): Backend of the batches. Defaults to "numpy".
+        """
+        backend = _convert_parameter_to_backend(backend)
+        if backend == ext.Backend.GeNN:
+            raise ValueError("Frames cannot be batched with GeNN")
+        for frames in self.batch_iterator(window_us, stride_us, batch):
+            yield _to_backend(frames, backend)
+
+
+class SharedMemoryInput(FrameInput, ext.SharedMemoryInput):
+    """
+    Reads batches of events published to shared memory by the "shm" output of
+    the aestream command line tool, on the same machine. Each batch is copied
+    out of shared memory in one go and only accumulated if the producer left it
+    alone meanwhile. The producer never waits for the input: when it falls a
+    whole ring behind, the input skips ahead and counts the batches it lost.
+
+    Parameters:
+        shape (tuple): Shape of the camera surface in pixels (X, Y).
+        device (str): Device name. Defaults to "cpu"
+        name (str): Name of the shared memory ring, as given to the output.
+            Defaults to "aestream".
+        **options: How events are accumulated into frames, as described in
+            FrameInput.
+    """
+
+
+class TCPInput(FrameInput, ext.TCPInput):
+    """
+    Reads frames of events sent by the "tcp" or "unix" outputs of the
+    aestream command line tool. Frames hold the events as they are laid out in
+    memory, so they are accumulated without decoding.
+
+    Parameters:
+        shape (tuple): Shape of the camera surface in pixels (X, Y).
+        device (str): Device name. Defaults to "cpu"
+        port (int): TCP port to listen on. Defaults to 3333.
+        path (str): Path of a Unix domain socket to listen on instead of the
+            TCP port. Defaults to none.
+        **options: How events are accumulated into frames, as described in
+            FrameInput.
+    """
+
+
+class UDPInput(FrameInput, ext.UDPInput):
     """
     Reads events from a UDP socket.
 
@@ -78,13 +386,21 @@ class UDPInput(ext.UDPInput):
         shape (tuple): Shape of the camera surface in pixels (X, Y).
         device (str): Device name. Defaults to "cpu"
         port (int): Port to listen on. Defaults to 3333.
+        threads (int): Number of threads receiving packets, each on its own
+            socket sharing the port, into frames merged on read. Defaults to 1.
+        receive_buffer (int): Size of the kernel queue of each socket in bytes.
+            Defaults to 0, which keeps the system default.
+        multicast_groups (list): IPv4 or IPv6 multicast groups to join, such as
+            "239.0.0.1" or "ff02::1%eth0", to receive the packets sent to them
+            as well. Requires a single thread. Defaults to none.
+        **options: How events are accumulated into frames, as described in
+            FrameInput.
     """
 
-    def read(self, backend: ext.Backend = ext.Backend.Numpy):
-        return _read_backend(self, backend, None)
 
 if "caer" in ext.drivers or "metavision" in ext.drivers:
-    class USBInput(ext.USBInput):
+
+    class USBInput(FrameInput, ext.USBInput):
         """
         Reads events from a USB camera.
 
@@ -93,13 +409,22 @@ if "caer" in ext.drivers or "metavision" in ext.drivers:
             device (str): Device name. Defaults to "cpu"
             device_id (int): Device ID. Defaults to 0.
             device_address (int): Device address, typically on the bus. Defaults to 0.
+            **options: How events are accumulated into frames, as described in
+                FrameInput.
         """
 
-        def read(self, backend: ext.Backend = ext.Backend.Numpy):
-            return _read_backend(self, backend, None)
 
 if "zmq" in ext.drivers:
 
-    class SpeckInput(ext.SpeckInput):
-        def read(self, backend: ext.Backend = ext.Backend.Numpy):
-            return _read_backend(self, backend, None)
+    class SpeckInput(FrameInput, ext.SpeckInput):
+        """
+        Reads events from a SynSense Speck chip, or from `aestream ... output zmq`,
+        over ZMQ.
+
+        Parameters:
+            shape (tuple): Shape of the camera surface in pixels (X, Y).
+            device (str): Device name. Defaults to "cpu"
+            address (str): ZMQ address to subscribe to. Defaults to "tcp://0.0.0.0:40001".
+            **options: How events are accumulated into frames, as described in
+                FrameInput.
+        """
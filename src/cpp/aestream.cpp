@@ -10,9 +10,12 @@
 
 // AER imports
 #include "aer.hpp"
+#include "pacer.hpp"
+#include "region.hpp"
 
 // Input
 #include "input/file.hpp"
+#include "input/stream.hpp"
 #ifdef WITH_CAER
 #include "input/inivation.hpp"
 #endif
@@ -25,7 +28,12 @@
 
 // Output
 #include "output/dvs_to_file.hpp"
+#include "output/dvs_to_shm.hpp"
+#include "output/dvs_to_stream.hpp"
 #include "output/dvs_to_udp.hpp"
+#ifdef WITH_ZMQ
+#include "output/dvs_to_zmq.hpp"
+#endif
 #ifdef WITH_SDL
 #include "viewer/viewer.hpp"
 #endif
@@ -34,26 +42,17 @@
 auto runFlag = std::atomic<bool>(true);
 void signalHandler(int signum) { runFlag.store(false); }
 
-template <typename EventTime>
-Generator<AER::Event> synchronize_time(Generator<AER::Event> &generator) {
-  auto start_real = std::chrono::high_resolution_clock::now();
-  auto start_event = EventTime(0);
-  for (AER::Event event : generator) {
-    start_event = EventTime(event.timestamp);
-    break;
-  }
-  for (AER::Event event : generator) {
-    auto now_real = std::chrono::high_resolution_clock::now();
-    auto now_event = EventTime(event.timestamp);
-    auto event_diff = now_real - start_real;
-    auto real_diff = now_event - start_event;
-    auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(real_diff - event_diff);
-    if (diff.count() > 0) {
-      std::this_thread::sleep_for(diff);
-    }
-    co_yield event;
+std::chrono::nanoseconds parse_time_unit(const std::string &unit) {
+  if (unit == "ns") {
+    return std::chrono::nanoseconds(1);
+  } else if (unit == "us") {
+    return std::chrono::microseconds(1);
+  } else if (unit == "ms") {
+    return std::chrono::milliseconds(1);
+  } else if (unit == "s") {
+    return std::chrono::seconds(1);
   }
-  co_return;
+  throw std::invalid_argument("Invalid time unit: " + unit);
 }
 
 // Main
@@ -96,6 +95,7 @@ int main(int argc, char *argv[]) {
   std::string input_filename = "None";
   bool input_ignore_time = false;
   std::string input_time_unit = "us";
+  double input_speed = 1;
   auto app_input_file = app_input->add_subcommand("file", "AEDAT4 input file");
   app_input_file
       ->add_option("file", input_filename, "Path to .aedat or .aedat4 file")
@@ -106,12 +106,29 @@ int main(int argc, char *argv[]) {
   app_input_file->add_option(
       "--time-unit", input_time_unit,
       "Time unit for timestamps. Defaults to microseconds. Options: ns, us, ms, s");
+  app_input_file
+      ->add_option("--speed", input_speed,
+                   "Playback speed relative to the recording, from 0.1 to "
+                   "100. Defaults to 1")
+      ->check(CLI::Range(Pacer::MIN_SPEED, Pacer::MAX_SPEED));
   // - ZMQ
   std::string input_zmq_socket = "tcp://0.0.0.0:40001";
   auto app_input_zmq =
       app_input->add_subcommand("speck", "SynSense Speck input");
   app_input_zmq->add_option("sock", input_zmq_socket,
                             "ZMQ socket. Defaults to tcp://0.0.0.0:40001");
+  // - TCP and Unix domain sockets
+  std::string input_tcp_port = "3333";
+  auto app_input_tcp = app_input->add_subcommand(
+      "tcp", "Event frames from a stream output over TCP");
+  app_input_tcp->add_option("port", input_tcp_port,
+                            "Port to listen on. Defaults to 3333");
+  std::string input_unix_path;
+  auto app_input_unix = app_input->add_subcommand(
+      "unix", "Event frames from a stream output over a Unix domain socket");
+  app_input_unix
+      ->add_option("path", input_unix_path, "Socket path to listen on")
+      ->required();
 
   //
   // Output
@@ -132,13 +149,134 @@ int main(int argc, char *argv[]) {
                              "Destination IP. Defaults to localhost");
   app_output_udp->add_option("port", port,
                              "Destination port. Defaults to 3333");
-  app_output_udp->add_option("--buffer-size", bufferSize,
-                             "UDP buffer size. Defaults to 1024");
+  app_output_udp->add_option(
+      "--buffer-size", bufferSize,
+      "Number of events sent with one system call. Defaults to 1024");
   app_output_udp->add_option(
       "--packet-size", packetSize,
       "Number of events in a single UDP packet. Defaults to 128");
   app_output_udp->add_option("--include-timestamp", include_timestamp,
                              "Include timestamp in events");
+  bool udp_compress = false;
+  bool udp_lz4 = false;
+  app_output_udp->add_flag(
+      "--compress", udp_compress,
+      "Sort, delta-code and pack the timestamped events of each packet");
+  app_output_udp->add_flag(
+      "--lz4", udp_lz4,
+      "Compress packed packets with LZ4 as well. Implies --compress");
+  std::vector<std::string> udp_destinations;
+  app_output_udp->add_option(
+      "--to", udp_destinations,
+      "Further destinations as host:port, such as 10.0.0.2:3333 or "
+      "[ff02::1%eth0]:3333. Multicast groups are destinations too");
+  int multicast_hops = 1;
+  app_output_udp->add_option(
+      "--multicast-ttl", multicast_hops,
+      "Routers that packets to multicast groups may pass. Defaults to 1");
+  UDPPacing udp_pacing;
+  double packet_gap_us = 0;
+  std::string overflow = "block";
+  app_output_udp
+      ->add_option("--max-event-rate", udp_pacing.events_per_second,
+                   "Most events sent per second. Defaults to no limit")
+      ->check(CLI::NonNegativeNumber);
+  app_output_udp
+      ->add_option("--max-byte-rate", udp_pacing.bytes_per_second,
+                   "Most bytes sent per second. Defaults to no limit")
+      ->check(CLI::NonNegativeNumber);
+  app_output_udp
+      ->add_option("--burst", udp_pacing.burst,
+                   "Packets that may be sent back to back under a rate limit. "
+                   "Defaults to 1")
+      ->check(CLI::PositiveNumber);
+  app_output_udp
+      ->add_option("--packet-gap", packet_gap_us,
+                   "Least time between packets in microseconds. Defaults to 0")
+      ->check(CLI::NonNegativeNumber);
+  app_output_udp
+      ->add_option("--queue", udp_pacing.queue_packets,
+                   "Packets waiting to be sent under a rate limit. Defaults "
+                   "to 1024")
+      ->check(CLI::PositiveNumber);
+  app_output_udp
+      ->add_option("--overflow", overflow,
+                   "What to do when the queue is full: block (default) the "
+                   "input, drop-oldest or drop-newest packets")
+      ->check(CLI::IsMember({"block", "drop-oldest", "drop-newest"}));
+  bool udp_stats = false;
+  app_output_udp->add_flag(
+      "--stats", udp_stats,
+      "Print the packets, bytes and system calls sent every second");
+  // - TCP and Unix domain sockets
+  std::string stream_host = "localhost";
+  std::string stream_port = "3333";
+  std::string stream_path;
+  std::uint32_t stream_frame_size = 8192;
+  bool stream_zerocopy = false;
+  bool stream_stats = false;
+  auto app_output_tcp = app_output->add_subcommand(
+      "tcp", "Frames of events over a TCP connection");
+  app_output_tcp->add_option("destination", stream_host,
+                             "Host to connect to. Defaults to localhost");
+  app_output_tcp->add_option("port", stream_port,
+                             "Port to connect to. Defaults to 3333");
+  app_output_tcp->add_flag(
+      "--zerocopy", stream_zerocopy,
+      "Let the kernel send events from our memory with MSG_ZEROCOPY, if "
+      "supported");
+  auto app_output_unix = app_output->add_subcommand(
+      "unix", "Frames of events over a Unix domain socket");
+  app_output_unix->add_option("path", stream_path, "Socket path to connect to")
+      ->required();
+  for (auto *app_output_stream : {app_output_tcp, app_output_unix}) {
+    app_output_stream
+        ->add_option("--frame-size", stream_frame_size,
+                     "Most events in one frame. Defaults to 8192")
+        ->check(CLI::Range(std::uint32_t(1), StreamFrameHeader::MAX_EVENTS));
+    app_output_stream->add_flag(
+        "--stats", stream_stats,
+        "Print the frames, bytes, system calls and stalls every second");
+  }
+  // - SHARED MEMORY
+  std::string shm_name = "aestream";
+  std::uint32_t shm_slots = 1024;
+  std::uint32_t shm_batch_size = 1024;
+  bool shm_stats = false;
+  auto app_output_shm = app_output->add_subcommand(
+      "shm", "Ring of event batches in shared memory, for local processes");
+  app_output_shm->add_option("name", shm_name,
+                             "Name of the shared memory. Defaults to aestream");
+  app_output_shm
+      ->add_option("--slots", shm_slots,
+                   "Batches the ring holds before consumers lose the oldest. "
+                   "Defaults to 1024")
+      ->check(CLI::Range(std::uint32_t(2), std::uint32_t(1) << 20));
+  app_output_shm
+      ->add_option("--batch-size", shm_batch_size,
+                   "Most events in one batch. Defaults to 1024")
+      ->check(CLI::Range(std::uint32_t(1), std::uint32_t(1) << 24));
+  app_output_shm->add_flag(
+      "--stats", shm_stats,
+      "Print the batches published and the lag of each consumer every second");
+  // - ZMQ
+#ifdef WITH_ZMQ
+  std::string zmq_address = "tcp://0.0.0.0:40001";
+  std::uint32_t zmq_batch_size = 1024;
+  bool zmq_stats = false;
+  auto app_output_zmq = app_output->add_subcommand(
+      "zmq", "Batches of events published on a ZMQ PUB socket");
+  app_output_zmq->add_option(
+      "address", zmq_address,
+      "Address to publish on. Defaults to tcp://0.0.0.0:40001");
+  app_output_zmq
+      ->add_option("--batch-size", zmq_batch_size,
+                   "Most events in one message. Defaults to 1024")
+      ->check(CLI::Range(std::uint32_t(1), std::uint32_t(1) << 24));
+  app_output_zmq->add_flag(
+      "--stats", zmq_stats,
+      "Print the batches published and dropped every second");
+#endif
   // - FILE
   std::string output_filename;
   auto app_output_file = app_output->add_subcommand("file", "File output");
@@ -171,6 +309,16 @@ int main(int argc, char *argv[]) {
   app.add_option("--max-packets", maxPackets,
                  "Maximum number of packets to read before stopping. Defaults "
                  "to -1 (infinite).");
+  std::vector<std::uint16_t> roi;
+  app.add_option("--roi", roi,
+                 "Region of the sensor to keep, as x y width height. Events "
+                 "outside it are dropped. Defaults to the whole sensor")
+      ->expected(4);
+  std::uint16_t downsample = 1;
+  app.add_option("--downsample", downsample,
+                 "Integer factor to divide event coordinates by, after "
+                 "cropping to the region. Defaults to 1")
+      ->check(CLI::PositiveNumber);
 
   CLI11_PARSE(app, argc, argv);
 
@@ -179,6 +327,7 @@ int main(int argc, char *argv[]) {
   //
   Generator<AER::Event> input_generator, tmp_generator;
   std::unique_ptr<FileBase> file_handle = nullptr;
+  std::unique_ptr<Pacer> pacer = nullptr;
   if (app_input_inivation->parsed()) {
 #ifdef WITH_CAER
     input_generator = inivation_event_generator(
@@ -201,19 +350,10 @@ int main(int argc, char *argv[]) {
     file_handle = open_event_file(input_filename);
 
     if (!input_ignore_time) {
-      if (input_time_unit == "ns") {
-        tmp_generator = file_handle->stream();
-        input_generator = synchronize_time<std::chrono::nanoseconds>(tmp_generator);
-      } else if (input_time_unit == "us") {
-        tmp_generator = file_handle->stream();
-        input_generator = synchronize_time<std::chrono::microseconds>(tmp_generator);
-      } else if (input_time_unit == "ms") {
-        input_generator = synchronize_time<std::chrono::milliseconds>(tmp_generator);
-      } else if (input_time_unit == "s") {
-        input_generator = synchronize_time<std::chrono::seconds>(tmp_generator);
-      } else {
-        throw std::invalid_argument("Invalid time unit: " + input_time_unit);
-      }
+      pacer = std::make_unique<Pacer>(input_speed,
+                                      parse_time_unit(input_time_unit));
+      tmp_generator = file_handle->stream();
+      input_generator = pace_events(tmp_generator, *pacer, &runFlag);
     } else{
       input_generator = file_handle->stream();
     }
@@ -223,6 +363,21 @@ int main(int argc, char *argv[]) {
     input_generator = open_zmq(input_zmq_socket, runFlag);
   }
 #endif
+  else if (app_input_tcp->parsed()) {
+    input_generator = open_stream(listen_tcp(input_tcp_port), runFlag);
+  } else if (app_input_unix->parsed()) {
+    input_generator = open_stream(listen_unix(input_unix_path), runFlag);
+  }
+
+  // Crop and downsample before any output sees the events
+  Generator<AER::Event> uncropped_generator;
+  if (!roi.empty() || downsample > 1) {
+    const Region region =
+        roi.empty() ? Region(0, 0, UINT16_MAX, UINT16_MAX, downsample)
+                    : Region(roi[0], roi[1], roi[2], roi[3], downsample);
+    uncropped_generator = std::move(input_generator);
+    input_generator = crop_events(uncropped_generator, region);
+  }
 
 
   //
@@ -230,11 +385,72 @@ int main(int argc, char *argv[]) {
   //
   try {
     if (app_output_udp->parsed()) {
-      std::cout << "Sending events to: " << ipAddress << " on port: " << port
+      std::vector<UDPDestination> destinations = {{ipAddress, port}};
+      for (const auto &destination : udp_destinations) {
+        destinations.push_back(UDPDestination::parse(destination, port));
+      }
+      for (const auto &destination : destinations) {
+        std::cout << "Sending events to: " << destination.host
+                  << " on port: " << destination.port << std::endl;
+      }
+      DVSToUDP<AER::Event> client(bufferSize, destinations, packetSize,
+                                  udp_stats, multicast_hops);
+      UDPEncoding encoding = include_timestamp ? UDPEncoding::Timed
+                                               : UDPEncoding::SPIF;
+      if (udp_lz4) {
+        encoding = UDPEncoding::PackedLZ4;
+      } else if (udp_compress) {
+        encoding = UDPEncoding::Packed;
+      }
+      udp_pacing.packet_gap = std::chrono::nanoseconds(
+          static_cast<int64_t>(packet_gap_us * 1000));
+      udp_pacing.overflow = overflow == "drop-oldest"
+                                ? OverflowPolicy::DropOldest
+                            : overflow == "drop-newest"
+                                ? OverflowPolicy::DropNewest
+                                : OverflowPolicy::Block;
+      client.set_pacing(udp_pacing);
+      client.stream(input_generator, encoding);
+      if (udp_pacing.enabled() && client.stats().dropped_packets > 0) {
+        std::cerr << "Dropped " << client.stats().dropped_events
+                  << " events in " << client.stats().dropped_packets
+                  << " packets to keep the rate" << std::endl;
+      }
+    } else if (app_output_tcp->parsed() || app_output_unix->parsed()) {
+      const int sockfd = app_output_tcp->parsed()
+                             ? connect_tcp(stream_host, stream_port)
+                             : connect_unix(stream_path);
+      DVSToStream<AER::Event> client(sockfd, stream_frame_size,
+                                     stream_zerocopy, stream_stats);
+      client.stream(input_generator);
+      const auto stats = client.stats();
+      if (stats.stalls > 0) {
+        std::cerr << "Stalled " << stats.stalls << " times for "
+                  << stats.stall_us / 1000 << "ms waiting for the receiver"
+                  << std::endl;
+      }
+    } else if (app_output_shm->parsed()) {
+      DVSToShm<AER::Event> ring(shm_name, shm_slots, shm_batch_size,
+                                shm_stats);
+      std::cout << "Publishing events to shared memory " << ring.name
                 << std::endl;
-      DVSToUDP<AER::Event> client(bufferSize, port, ipAddress);
-      client.stream(input_generator, include_timestamp);
-    } else if (app_output_file->parsed()) {
+      ring.stream(input_generator);
+    }
+#ifdef WITH_ZMQ
+    else if (app_output_zmq->parsed()) {
+      DVSToZMQ<AER::Event> publisher(zmq_address, zmq_batch_size, zmq_stats);
+      std::cout << "Publishing events on ZMQ socket " << zmq_address
+                << std::endl;
+      publisher.stream(input_generator);
+      const auto stats = publisher.stats();
+      if (stats.dropped_batches > 0) {
+        std::cerr << "Dropped " << stats.dropped_events << " events in "
+                  << stats.dropped_batches << " batches ZMQ could not queue"
+                  << std::endl;
+      }
+    }
+#endif
+    else if (app_output_file->parsed()) {
       std::cout << "Sending events to file " << output_filename << std::endl;
       if (output_filename.ends_with(".csv") || output_filename.ends_with(".txt")) {
         dvs_to_file_csv(input_generator, output_filename);
@@ -264,4 +480,13 @@ int main(int argc, char *argv[]) {
   } catch (const std::exception &e) {
     std::cout << "Failure while streaming events: " << e.what() << "\n";
   }
+
+  if (pacer) {
+    const auto stats = pacer->stats();
+    std::cerr << "Paced " << stats.batches << " batches, "
+              << stats.late_batches << " late by " << stats.mean_lag_us
+              << "us on average (max " << stats.max_lag_us << "us), others "
+              << "early by " << stats.mean_lead_us << "us on average (max "
+              << stats.max_lead_us << "us)" << std::endl;
+  }
 }
\ No newline at end of file
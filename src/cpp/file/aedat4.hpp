@@ -164,41 +164,48 @@ struct AEDAT4 : FileBase {
     stream.write(compressed, size);
   }
 
+  size_t count_events() { return total_number_of_events; }
+
+  size_t count_remaining_events() {
+    return total_number_of_events - events_read;
+  }
+
   std::tuple<std::vector<AER::Event>, size_t>
   read_events(const int64_t n_events = -1) {
-    int64_t byte_count =
-        (n_events > 0 ? n_events : total_number_of_events) * sizeof(AER::Event);
-    std::vector<AER::Event> events{};
-    events.resize(n_events > 0 ? n_events : total_number_of_events);
-
-    int64_t count = 0;
-    while (get_packet()) {
-      for (; packet_events_read < event_vector->size(); ++packet_events_read) {
-        const Event *event = event_vector->Get(packet_events_read);
-        if (n_events > 0 && n_events - count <= 0) {
-          return {events, count};
-        }
+    const size_t remaining = count_remaining_events();
+    std::vector<AER::Event> events(
+        n_events > 0 ? std::min<size_t>(n_events, remaining) : remaining);
+    const size_t count = read_into(events);
+    events.resize(count);
+    return {std::move(events), count};
+  }
 
-        const auto e = AER::Event{
+  size_t read_into(std::span<AER::Event> out) {
+    size_t count = 0;
+    while (count < out.size() && get_packet()) {
+      for (; packet_events_read < event_vector->size() && count < out.size();
+           ++packet_events_read) {
+        const Event *event = event_vector->Get(packet_events_read);
+        out[count] = AER::Event{
             static_cast<uint64_t>(event->t()),
             static_cast<uint16_t>(event->x()),
             static_cast<uint16_t>(event->y()),
             static_cast<bool>(event->on()),
         };
-        events[count] = e;
         count += 1;
       }
     }
-    return {events, count};
+    events_read += count;
+    return count;
   }
+  using FileBase::read_into;
 
   Generator<AER::Event> stream(const int64_t n_events = -1) {
     int64_t size = 0, count = 0;
     static const size_t STREAM_BUFFER_SIZE = 128;
+    AER::Event events[STREAM_BUFFER_SIZE];
     do {
-      auto ret = read_events(STREAM_BUFFER_SIZE);
-      auto events = std::get<0>(ret);
-      size = std::get<1>(ret);
+      size = read_into(events);
       for (size_t i = 0; i < size; i++) {
         co_yield events[i];
         count++;
@@ -223,6 +230,7 @@ private:
   const file_t fp;
 
   size_t total_number_of_events = 0;
+  size_t events_read = 0;
   std::vector<uint8_t> dst_buffer;
   std::vector<char> packet_buffer;
   size_t packet_index = 0;
@@ -14,35 +14,83 @@ struct CSV : FileBase {
 
   Generator<AER::Event> stream(const int64_t n_events = -1) {
     std::string line;
-    std::smatch event_match;
     size_t sum = 0;
-    while (std::getline(file_stream, line) &&
-           (n_events < 0 || sum < n_events)) {
-      std::regex_match(line, event_match, csv_regex);
-      uint64_t timestamp = static_cast<uint64_t>(std::stol(event_match[1]));
-      uint16_t x = static_cast<uint16_t>(std::stol(event_match[2]));
-      uint16_t y = static_cast<uint16_t>(std::stol(event_match[3]));
-      co_yield AER::Event{timestamp, x, y, std::stoi(event_match[4]) > 0};
+    while ((n_events < 0 || sum < n_events) &&
+           std::getline(file_stream, line)) {
+      co_yield parse_line(line);
       sum++;
     }
     co_return;
   }
 
+  size_t count_events() { return count_lines(0); }
+
+  size_t count_remaining_events() {
+    // Nothing is left once an earlier read reached the end of the file
+    if (!file_stream.good()) {
+      return 0;
+    }
+    return count_lines(file_stream.tellg());
+  }
+
   std::tuple<std::vector<AER::Event>, size_t>
   read_events(const int64_t n_events = -1) {
-    size_t sum = 0;
-    Generator<AER::Event> event_stream = stream(n_events);
-    std::vector<AER::Event> event_vector;
-    for (auto event : event_stream) {
-      event_vector.push_back(event);
+    if (!file_stream.good()) {
+      return {std::vector<AER::Event>(), 0};
+    }
+    std::vector<AER::Event> event_vector(
+        n_events > 0 ? n_events : count_remaining_events());
+    const size_t size = read_into(event_vector);
+    event_vector.resize(size);
+    return {std::move(event_vector), size};
+  }
+
+  size_t read_into(std::span<AER::Event> out) {
+    std::string line;
+    size_t count = 0;
+    while (count < out.size() && std::getline(file_stream, line)) {
+      out[count++] = parse_line(line);
     }
-    return {event_vector, event_vector.size()};
+    return count;
   }
+  using FileBase::read_into;
 
   explicit CSV(const std::string &filename)
-      : file_stream(filename), csv_regex("(\\d+),(\\d+),(\\d+),(\\d+)") {}
+      : file_stream(filename), csv_regex("(\\d+),(\\d+),(\\d+),(\\d+)"),
+        filename(filename) {
+    if (!file_stream) {
+      throw std::invalid_argument("Cannot open file " + filename);
+    }
+  }
 
 private:
   std::ifstream file_stream;
   const std::regex csv_regex;
+  const std::string filename;
+
+  AER::Event parse_line(const std::string &line) {
+    std::smatch event_match;
+    std::regex_match(line, event_match, csv_regex);
+    uint64_t timestamp = static_cast<uint64_t>(std::stol(event_match[1]));
+    uint16_t x = static_cast<uint16_t>(std::stol(event_match[2]));
+    uint16_t y = static_cast<uint16_t>(std::stol(event_match[3]));
+    return AER::Event{timestamp, x, y, std::stoi(event_match[4]) > 0};
+  }
+
+  // Counts the lines from the given byte offset to the end of the file. A
+  // trailing line without a newline is counted as well. The file is opened
+  // apart from the stream, only while counting.
+  size_t count_lines(long offset) {
+    const file_t fp = open_file(filename);
+    const long bytes = file_size(fp.get());
+    const size_t newlines = parallel_count(
+        fp.get(), offset, bytes, [](const uint8_t *block, size_t size) {
+          return static_cast<size_t>(std::count(block, block + size, '\n'));
+        });
+    char last = '\n';
+    if (bytes > offset && pread(fileno(fp.get()), &last, 1, bytes - 1) != 1) {
+      throw std::runtime_error("Error when counting events in .csv file");
+    }
+    return newlines + (last != '\n');
+  }
 };
@@ -43,29 +43,36 @@ struct DAT : FileBase {
     } while (size > 0);
   }
 
+  size_t count_events() { return total_number_of_events; }
+
+  size_t count_remaining_events() {
+    return (file_size(fp.get()) - ftell(fp.get())) / sizeof(uint64_t);
+  }
+
   std::tuple<std::vector<AER::Event>, size_t>
   read_events(const int64_t n_events = -1) {
-    static const size_t READ_BUFFER_SIZE = 4096;
-    const size_t buffer_size = n_events > 0 ? n_events : READ_BUFFER_SIZE;
-    const size_t event_array_size =
-        n_events > 0 ? n_events : total_number_of_events;
-
-    std::vector<uint64_t> buffer_vector = std::vector<uint64_t>();
-    buffer_vector.resize(buffer_size);
-    uint64_t *buffer = buffer_vector.data();
-    std::vector<AER::Event> events{};
-    events.reserve(event_array_size);
-    size_t timestep = 0, overflows = 0, index = 0, size = 0;
-    do {
-      size = fread(buffer, sizeof(uint64_t), buffer_size, fp.get());
-
-      if (size == 0 && !feof(fp.get())) {
-        throw std::runtime_error("Error when processing .dat file");
-      }
+    const size_t remaining = count_remaining_events();
+    std::vector<AER::Event> events(
+        n_events > 0 ? std::min<size_t>(n_events, remaining) : remaining);
+    const size_t size = read_into(events);
+    events.resize(size);
+    return {std::move(events), size};
+  }
 
-      if (size > n_events - index) {
-        fseek(fp.get(), size - (n_events - index), SEEK_CUR); // Re-align file
-        size = n_events - index;
+  size_t read_into(std::span<AER::Event> out) {
+    static const size_t READ_BUFFER_SIZE = 4096;
+    uint64_t buffer[READ_BUFFER_SIZE];
+    size_t timestep = 0, overflows = 0, index = 0;
+    while (index < out.size()) {
+      const size_t size =
+          fread(buffer, sizeof(uint64_t),
+                std::min(READ_BUFFER_SIZE, out.size() - index), fp.get());
+
+      if (size == 0) {
+        if (!feof(fp.get())) {
+          throw std::runtime_error("Error when processing .dat file");
+        }
+        break;
       }
 
       for (size_t i = 0; i < size; ++i) {
@@ -74,12 +81,13 @@ struct DAT : FileBase {
           overflows++;
           event.timestamp = (overflows << 32) | event.timestamp;
         }
-        events.push_back(event);
+        out[index + i] = event;
       }
       index += size;
-    } while (size > 0 && n_events - index > 0);
-    return {events, index};
+    }
+    return index;
   }
+  using FileBase::read_into;
 
   explicit DAT(const std::string &filename) : DAT(open_file(filename)) {}
   explicit DAT(file_t &&fp)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <bit>
 #include <optional>
 
 #include "../aer.hpp"
@@ -68,44 +69,61 @@ struct EVT3 : FileBase {
 
   std::tuple<std::vector<AER::Event>, size_t>
   read_events(const int64_t n_events = -1) {
-    static const size_t READ_BUFFER_SIZE = 4096;
-    const size_t buffer_size = n_events > 0 && n_events < READ_BUFFER_SIZE
-                                   ? n_events * 2
-                                   : READ_BUFFER_SIZE;
-    // If reading the full file we reserve bytes / 5 as a lower estimate
-    const size_t event_array_size = n_events > 0 ? n_events : file_bytes / 5;
-
-    std::vector<uint16_t> buffer_vector = std::vector<uint16_t>();
-    buffer_vector.reserve(buffer_size);
-    uint16_t *buffer = buffer_vector.data();
+    // If reading the full file we count the remaining events up front
+    std::vector<AER::Event> events(n_events > 0 ? n_events
+                                                : count_remaining_events());
+    const size_t size = read_into(events);
+    events.resize(size);
+    return {std::move(events), size};
+  }
 
-    std::vector<AER::Event> events{};
-    events.reserve(event_array_size);
+  size_t read_into(std::span<AER::Event> out) {
+    size_t count = 0;
+    // Process left-over vector event from previous call, if any
+    if (state.bits_remaining > 0 && !out.empty()) {
+      state = process_vector_event(out, count);
+    }
 
-    size_t size = 0;
-    do {
-      size = fread(buffer, sizeof(uint16_t), buffer_size, fp.get());
-      if (size == 0 && !feof(fp.get())) {
-        throw std::runtime_error("Error when processing .evt3 file");
+    while (count < out.size()) {
+      const size_t size = fread(read_buffer.data(), sizeof(uint16_t),
+                                read_buffer.size(), fp.get());
+      if (size == 0) {
+        if (!feof(fp.get())) {
+          throw std::runtime_error("Error when processing .evt3 file");
+        }
+        break;
       }
 
-      auto offset = decode_event_buffer(
-          buffer, size, events,
-          n_events < 0 ? buffer_size : n_events - events.size());
+      auto offset = decode_event_buffer(read_buffer.data(), size, out, count);
       fseek(fp.get(), offset * sizeof(uint16_t),
             SEEK_CUR); // Re-align file if we didn't process all events
+    }
+    return count;
+  }
+  using FileBase::read_into;
 
-    } while (size != 0 && (n_events < 0 || events.size() - n_events > 0));
+  size_t count_events() {
+    return parallel_count(fp.get(), data_offset, file_bytes, count_event_words,
+                          sizeof(uint16_t));
+  }
 
-    return {events, events.size()};
+  // Includes a vector event left over from the previous read
+  size_t count_remaining_events() {
+    const size_t leftover =
+        state.bits_remaining > 0
+            ? std::popcount(static_cast<uint16_t>(
+                  state.bits >> (state.bit_size - state.bits_remaining)))
+            : 0;
+    return leftover + parallel_count(fp.get(), ftell(fp.get()), file_bytes,
+                                     count_event_words, sizeof(uint16_t));
   }
 
   Generator<AER::Event> stream(const int64_t n_events = -1) {
     static const size_t STREAM_BUFFER_SIZE = 4096;
     int64_t size = 0, count = 0;
-    std::vector<AER::Event> events;
+    std::vector<AER::Event> events(STREAM_BUFFER_SIZE);
     do {
-      std::tie(events, size) = read_events(STREAM_BUFFER_SIZE);
+      size = read_into(events);
       for (size_t i = 0; i < size; i++) {
         co_yield events[i];
         count++;
@@ -116,43 +134,63 @@ struct EVT3 : FileBase {
 
   explicit EVT3(const std::string &filename) : EVT3(open_file(filename)) {}
   explicit EVT3(file_t &&fp)
-      : fp(std::move(fp)), file_bytes(file_size(this->fp.get())) {
+      : fp(std::move(fp)), file_bytes(file_size(this->fp.get())),
+        read_buffer(READ_BUFFER_SIZE) {
     skip_evt3_header();
+    data_offset = ftell(this->fp.get());
   }
 
 private:
+  static constexpr size_t READ_BUFFER_SIZE = 4096;
   static constexpr char HEADER_LINE_END = 0x0A;
   static constexpr char HEADER_LINE_START = 0x25;
   const file_t fp;
   const long file_bytes;
+  long data_offset = 0;
   bool is_first = true;
   uint32_t time_low = 0, time_high = 0, time_overflow_high = 0; // State
   uint64_t current_time = 0;
   std::optional<EventCoordinate> x_event = {};
   std::optional<EventCoordinate> y_event = {};
   ContainerProcessingState state = {};
+  std::vector<uint16_t> read_buffer;
+
+  // Counts events in a block of raw EVT3 words without decoding them: every
+  // EVT_ADDR_X word is one event and every VECT word holds one event per set
+  // bit. The loop is branch-free so the compiler can vectorize it.
+  static size_t count_event_words(const uint8_t *bytes, size_t size) {
+    const uint16_t *words = reinterpret_cast<const uint16_t *>(bytes);
+    const size_t n_words = size / sizeof(uint16_t);
+    size_t count = 0;
+    for (size_t i = 0; i < n_words; ++i) {
+      const uint16_t type = words[i] >> 12;
+      const uint16_t mask = (type == EventType::VECT_12) * 0x0FFF |
+                            (type == EventType::VECT_8) * 0x00FF;
+      count += std::popcount(static_cast<uint16_t>(words[i] & mask)) +
+               (type == EventType::EVT_ADDR_X);
+    }
+    return count;
+  }
 
   inline ContainerProcessingState
-  process_vector_event(std::vector<AER::Event> &events,
-                       int64_t remaining_events) {
+  process_vector_event(std::span<AER::Event> events, size_t &count) {
     if (!y_event.has_value() || !x_event.has_value()) {
       throw std::runtime_error("EVT3 file format error: no header data for "
                                "base (x, y) coordinates given");
     }
 
     uint16_t y = y_event.value().coordinate;
-    uint16_t i = state.bits_remaining;
+    uint16_t i = state.bit_size - state.bits_remaining;
     for (; i < state.bit_size; ++i) {
       if (state.bits & (1U << i)) {
-        const AER::Event event = {
-            current_time, static_cast<uint16_t>(x_event.value().coordinate), y,
-            x_event.value().meta};
-        events.push_back(std::move(event));
-        remaining_events--;
+        events[count++] = {current_time,
+                           static_cast<uint16_t>(x_event.value().coordinate),
+                           y, x_event.value().meta};
       }
       x_event.value()
           .coordinate++; // Increment coordinate irregardless of validity
-      if (remaining_events <= 0) {
+      if (count >= events.size()) {
+        ++i; // The current bit has been processed
         break;
       }
     }
@@ -164,20 +202,11 @@ private:
   }
 
   int32_t decode_event_buffer(uint16_t *buffer, size_t buffer_size,
-                              std::vector<AER::Event> &events,
-                              const size_t remaining_events) {
-    const size_t max_remaining_limit =
-        events.size() + remaining_events; // Maximum events to emit
-    AER::Event event;
+                              std::span<AER::Event> events, size_t &count) {
     EventCoordinate *x;
     Vect8 *vect8_event;
     Vect12 *vect12_event;
 
-    // Process left-over vector event from previous call, if any
-    if (state.bits_remaining > 0) {
-      state = process_vector_event(events, remaining_events);
-    }
-
     int64_t i = 0; // Buffer index
     for (; i < buffer_size; ++i) {
       auto raw_event = reinterpret_cast<RawEvent *>(&buffer[i]);
@@ -187,9 +216,9 @@ private:
         break;
       case EventType::EVT_ADDR_X:
         x = reinterpret_cast<EventCoordinate *>(raw_event);
-        event = {current_time, static_cast<uint16_t>(x->coordinate),
-                 static_cast<uint16_t>(y_event.value().coordinate), x->meta};
-        events.push_back(event);
+        events[count++] = {current_time, static_cast<uint16_t>(x->coordinate),
+                           static_cast<uint16_t>(y_event.value().coordinate),
+                           x->meta};
         break;
       case EventType::EVT_TIME_HIGH:
         static constexpr uint64_t TIMESTAMP_MAX = 1ULL << 11;
@@ -221,20 +250,19 @@ private:
         vect8_event = reinterpret_cast<Vect8 *>(raw_event);
         state.bits = vect8_event->valid;
         state.bit_size = 8;
-        state =
-            process_vector_event(events, max_remaining_limit - events.size());
+        state.bits_remaining = 8;
+        state = process_vector_event(events, count);
         break;
       case EventType::VECT_12:
         vect12_event = reinterpret_cast<Vect12 *>(raw_event);
         state.bits = vect12_event->valid;
         state.bit_size = 12;
-        state =
-            process_vector_event(events, max_remaining_limit - events.size());
+        state.bits_remaining = 12;
+        state = process_vector_event(events, count);
         break;
       }
 
-      if (events.size() >=
-          max_remaining_limit) { // Break if decoded enough events
+      if (count >= events.size()) { // Break if decoded enough events
         i++;
         break;
       }
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <queue>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
 
 #include "../aer.hpp"
 #include "../generator.hpp"
@@ -47,10 +54,141 @@ static long file_size(FILE *fp) {
   return size;
 }
 
+/**
+ * Counts items in the byte range [begin, end) of a file without touching the
+ * file position. The range is split into one chunk per hardware thread, and
+ * every chunk is read with pread and passed block-wise to count_block.
+ *
+ * @param fp The file to count in
+ * @param begin The first byte of the range
+ * @param end One past the last byte of the range
+ * @param count_block Function counting the items in a block of bytes
+ * @param alignment Chunk and block sizes are multiples of this many bytes
+ * @return The sum of all counts
+ * @throws std::runtime_error if the file could not be read
+ */
+template <typename F>
+size_t parallel_count(FILE *fp, long begin, long end, F count_block,
+                      size_t alignment = 1) {
+  static constexpr size_t COUNT_BLOCK_SIZE = 1 << 20;
+  if (end <= begin) {
+    return 0;
+  }
+  const size_t bytes = end - begin;
+  const size_t max_threads =
+      std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t n_threads =
+      std::min(max_threads, (bytes + COUNT_BLOCK_SIZE - 1) / COUNT_BLOCK_SIZE);
+  size_t chunk_size = (bytes + n_threads - 1) / n_threads;
+  chunk_size += (alignment - chunk_size % alignment) % alignment;
+
+  const int fd = fileno(fp);
+  std::vector<size_t> counts(n_threads, 0);
+  std::vector<uint8_t> failed(n_threads, false);
+  auto count_chunk = [&](size_t index) {
+    std::vector<uint8_t> block(COUNT_BLOCK_SIZE);
+    const size_t chunk_begin = begin + index * chunk_size;
+    const size_t chunk_end =
+        std::min<size_t>(chunk_begin + chunk_size, end);
+    for (size_t offset = chunk_begin; offset < chunk_end;) {
+      const size_t length = std::min(COUNT_BLOCK_SIZE, chunk_end - offset);
+      const ssize_t size = pread(fd, block.data(), length, offset);
+      if (size <= 0) {
+        failed[index] = size < 0;
+        return;
+      }
+      const size_t usable = size - size % alignment;
+      if (usable == 0) {
+        return;
+      }
+      counts[index] += count_block(block.data(), usable);
+      offset += usable;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < n_threads; i++) {
+    threads.emplace_back(count_chunk, i);
+  }
+  count_chunk(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (std::find(failed.begin(), failed.end(), true) != failed.end()) {
+    throw std::runtime_error("Error when counting events in file");
+  }
+  size_t sum = 0;
+  for (auto count : counts) {
+    sum += count;
+  }
+  return sum;
+}
+
+/**
+ * Column-oriented destination for decoded events. All columns must hold at
+ * least size() elements.
+ */
+struct EventColumns {
+  std::span<uint64_t> timestamp;
+  std::span<uint16_t> x;
+  std::span<uint16_t> y;
+  std::span<bool> polarity;
+
+  size_t size() const {
+    return std::min({timestamp.size(), x.size(), y.size(), polarity.size()});
+  }
+};
+
 struct FileBase
 {
   virtual ~FileBase() = default;
+  /**
+   * Counts the events in the file without decoding them.
+   */
+  virtual size_t count_events() = 0;
+  /**
+   * Counts the events left to decode from the current position in the file.
+   */
+  virtual size_t count_remaining_events() = 0;
   virtual Generator<AER::Event> stream(const int64_t n_events = -1) = 0;
   virtual std::tuple<std::vector<AER::Event>, size_t>
   read_events(const int64_t n_events = -1) = 0;
+
+  /**
+   * Decodes the next events directly into a caller-owned buffer.
+   *
+   * @param out The destination; at most out.size() events are decoded
+   * @return The number of events written, which is less than out.size() only
+   * at the end of the file
+   */
+  virtual size_t read_into(std::span<AER::Event> out) = 0;
+
+  /**
+   * Decodes the next events into caller-owned columns. Events are decoded in
+   * small chunks that stay in cache before being scattered to the columns.
+   *
+   * @param out The destination; at most out.size() events are decoded
+   * @return The number of events written
+   */
+  virtual size_t read_into(EventColumns out) {
+    static constexpr size_t COLUMN_CHUNK_SIZE = 1024;
+    AER::Event chunk[COLUMN_CHUNK_SIZE];
+    const size_t capacity = out.size();
+    size_t count = 0;
+    while (count < capacity) {
+      const size_t requested = std::min(COLUMN_CHUNK_SIZE, capacity - count);
+      const size_t size = read_into(std::span(chunk, requested));
+      for (size_t i = 0; i < size; i++) {
+        out.timestamp[count + i] = chunk[i].timestamp;
+        out.x[count + i] = chunk[i].x;
+        out.y[count + i] = chunk[i].y;
+        out.polarity[count + i] = chunk[i].polarity;
+      }
+      count += size;
+      if (size < requested) {
+        break;
+      }
+    }
+    return count;
+  }
 };
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+/**
+ * Sleeps while a word still holds the expected value, until woken or the
+ * timeout passes. Spurious wakeups are possible, so callers check their
+ * condition again. Words in shared memory work across processes.
+ */
+inline void futex_wait(std::atomic<uint32_t> &word, uint32_t expected,
+                       std::chrono::nanoseconds timeout) {
+  const struct timespec time = {
+      static_cast<time_t>(timeout.count() / 1000000000),
+      static_cast<long>(timeout.count() % 1000000000)};
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT,
+          expected, &time, nullptr, 0);
+}
+
+/// Wakes every thread sleeping on a word
+inline void futex_wake_all(std::atomic<uint32_t> &word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+}
@@ -1,10 +1,21 @@
+#include <chrono>
+#include <vector>
+
 #include "prophesee.hpp"
 
+// Events the ring between the camera callback and the generator holds, and
+// that the generator takes out of it at a time
+static const size_t RING_EVENTS = 1 << 20;
+static const size_t BATCH_EVENTS = 4096;
+
 // event generator for Prophesee cameras
 Generator<AER::Event> prophesee_event_generator(
     const std::atomic<bool> &runFlag,
     const std::optional<std::string> serial_number = std::nullopt) {
 
+  // The ring outlives the camera, whose SDK thread pushes into it until the
+  // camera is destroyed, even when the generator is dropped while suspended
+  SpscRing<AER::Event> ring(RING_EVENTS);
   Metavision::Camera cam;
 
   // get camera
@@ -37,38 +48,41 @@ Generator<AER::Event> prophesee_event_generator(
         "Please choose one of the above listed serial numbers and run again!");
   }
 
-  const Metavision::EventCD *ev_start = NULL, *ev_final = NULL;
-
-  // add event callback -> will set ev_start and ev_final to respective begin
-  // and end of event buffer
-  cam.cd().add_callback(
-      [&ev_start, &ev_final](const Metavision::EventCD *ev_begin,
-                             const Metavision::EventCD *ev_end) -> void {
-        ev_start = ev_begin;
-        ev_final = ev_end;
-      });
+  // The SDK reuses its buffers once the callback returns, so the callback
+  // copies their events into the ring, on a thread of the SDK. It never
+  // waits for us, and drops what does not fit.
+  cam.cd().add_callback([&ring](const Metavision::EventCD *ev_begin,
+                                const Metavision::EventCD *ev_end) -> void {
+    ring.push(ev_begin, ev_end, [](const Metavision::EventCD &ev) {
+      return AER::Event{(uint64_t)ev.t, ev.x, ev.y, (bool)ev.p};
+    });
+  });
 
   // start camera
   cam.start();
 
-  // keep running while camera is on or video is finished
+  // keep running while camera is on or video is finished, and wake up now
+  // and then to see whether to stop
+  std::vector<AER::Event> batch;
   while (cam.is_running() && runFlag.load()) {
-    if ((ev_start != NULL) && (ev_final != NULL)) {
-      // iterate over events in buffer and convert to AEDAT Polarity Event
-      for (const Metavision::EventCD *ev = ev_start; ev < ev_final; ++ev) {
-        const AER::Event polarityEvent = {
-            (uint64_t)ev->t,
-            ev->x,
-            ev->y,
-            (bool)ev->p,
-        };
-        co_yield polarityEvent;
-      }
-      ev_start = NULL;
-      ev_final = NULL;
+    ring.pop(batch, BATCH_EVENTS, std::chrono::milliseconds(100));
+    for (AER::Event event : batch) {
+      co_yield event;
     }
   }
 
   // if video is finished, stop camera - will never get here with live camera
   cam.stop();
+  while (runFlag.load() &&
+         ring.pop(batch, BATCH_EVENTS, std::chrono::nanoseconds(0)) > 0) {
+    for (AER::Event event : batch) {
+      co_yield event;
+    }
+  }
+  if (ring.dropped() > 0) {
+    std::cerr << "Dropped " << ring.dropped() << " events in "
+              << ring.dropped_batches()
+              << " camera buffers that arrived while the ring was full"
+              << std::endl;
+  }
 }
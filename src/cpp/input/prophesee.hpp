@@ -7,6 +7,7 @@
 
 #include "../aer.hpp"
 #include "../generator.hpp"
+#include "../spsc_ring.hpp"
 
 Generator<AER::Event>
 prophesee_event_generator(const std::atomic<bool> &runFlag,
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../futex.hpp"
+#include "shm.hpp"
+
+// Whether a process holding an entry or producing still runs
+static bool process_alive(int32_t pid) {
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+ShmRingReader::ShmRingReader(const std::string &name) {
+  const std::string object = shm_object_name(name);
+  const int fd = shm_open(object.c_str(), O_RDWR, 0);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to open shared memory " + object + ": " +
+                             strerror(errno));
+  }
+  // The producer sizes the object before it writes the layout, and writes
+  // the magic number last. Rings of producers that are done are of no use.
+  struct stat status;
+  void *memory = MAP_FAILED;
+  if (fstat(fd, &status) == 0 &&
+      static_cast<size_t>(status.st_size) >= sizeof(ShmRingHeader)) {
+    mapped_bytes = status.st_size;
+    memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    throw std::runtime_error("Shared memory " + object + " holds no ring");
+  }
+  header = static_cast<ShmRingHeader *>(memory);
+  const bool valid =
+      header->magic.load(std::memory_order_acquire) == ShmRingHeader::MAGIC &&
+      header->version == ShmRingHeader::VERSION && header->slots >= 2 &&
+      header->slot_bytes ==
+          ShmRingHeader::slot_bytes_for(header->slot_events) &&
+      header->total_bytes() <= mapped_bytes && !header->closed.load();
+  if (!valid) {
+    munmap(header, mapped_bytes);
+    header = nullptr;
+    throw std::runtime_error("Shared memory " + object + " holds no ring");
+  }
+
+  cursor = header->published.load();
+  for (auto &entry : header->consumers) {
+    int32_t pid = entry.pid.load();
+    if ((pid == 0 || !process_alive(pid)) &&
+        entry.pid.compare_exchange_strong(pid, getpid())) {
+      entry.cursor.store(cursor);
+      entry.lost.store(0);
+      consumer = &entry;
+      break;
+    }
+  }
+}
+
+ShmRingReader::~ShmRingReader() {
+  if (consumer) {
+    consumer->pid.store(0);
+  }
+  if (header) {
+    munmap(header, mapped_bytes);
+  }
+}
+
+ShmRingReader::Status
+ShmRingReader::next(std::span<const AER::Event> &events,
+                    std::chrono::nanoseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    const uint64_t published = header->published.load();
+    if (cursor < published) {
+      // Stay a slot clear of the one the producer writes next
+      if (published - cursor >= header->slots) {
+        const uint64_t skipped = published - cursor - (header->slots - 1);
+        lost += skipped;
+        cursor += skipped;
+      }
+      const ShmRingSlot *slot = ring_slot(header, cursor);
+      const uint64_t sequence =
+          slot->sequence.load(std::memory_order_acquire);
+      if (sequence != 2 * cursor + 2) {
+        // Overwritten since we looked
+        lost++;
+        cursor++;
+        continue;
+      }
+      events = {slot->data(), std::min(slot->events, header->slot_events)};
+      current = slot;
+      current_sequence = sequence;
+      cursor++;
+      if (consumer) {
+        consumer->cursor.store(cursor, std::memory_order_relaxed);
+        consumer->lost.store(lost, std::memory_order_relaxed);
+      }
+      return Status::Batch;
+    }
+    if (header->closed.load()) {
+      return Status::Closed;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      return producer_gone() ? Status::Closed : Status::Timeout;
+    }
+    // Announce that we sleep before looking again, so the producer either
+    // wakes us or we see its batch
+    header->waiters.fetch_add(1);
+    const uint32_t wakeups = header->wakeups.load();
+    if (header->published.load() == published && !header->closed.load()) {
+      futex_wait(header->wakeups, wakeups, deadline - now);
+    }
+    header->waiters.fetch_sub(1);
+  }
+}
+
+bool ShmRingReader::intact() {
+  if (!current) {
+    return true;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (current->sequence.load(std::memory_order_relaxed) == current_sequence) {
+    return true;
+  }
+  torn++;
+  return false;
+}
+
+uint64_t ShmRingReader::lag() const {
+  const uint64_t published = header->published.load();
+  return published - std::min(cursor, published);
+}
+
+bool ShmRingReader::producer_gone() const {
+  return !process_alive(header->producer.load());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "../aer.hpp"
+#include "../shm_ring.hpp"
+
+/**
+ * Reads the batches of a ring in POSIX shared memory, published by a
+ * DVSToShm producer in another process. Batches are read in place, without
+ * copying them out of the ring.
+ */
+class ShmRingReader {
+public:
+  enum class Status { Batch, Timeout, Closed };
+
+  /// Maps the ring of a producer and registers as one of its consumers,
+  /// starting at the next batch it publishes
+  /// @throws std::runtime_error if no open ring exists under the name
+  explicit ShmRingReader(const std::string &name);
+  ~ShmRingReader();
+  ShmRingReader(const ShmRingReader &) = delete;
+  ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+  /**
+   * Waits for the next batch and points the events at it, in shared memory.
+   * Readers that fell a ring behind skip ahead first, and count the batches
+   * they skipped as lost.
+   *
+   * @return Closed once the producer is gone and every batch was read
+   */
+  Status next(std::span<const AER::Event> &events,
+              std::chrono::nanoseconds timeout);
+  /// Whether the producer left the last batch alone while it was read. The
+  /// producer overwrites batches that readers hold for a whole ring.
+  bool intact();
+
+  /// Batches the producer published that this reader has yet to read
+  uint64_t lag() const;
+  uint64_t lost_batches() const { return lost; }
+  uint64_t torn_batches() const { return torn; }
+
+private:
+  ShmRingHeader *header = nullptr;
+  size_t mapped_bytes = 0;
+  // Entry of this reader among the consumers, if one was free
+  ShmRingHeader::Consumer *consumer = nullptr;
+
+  uint64_t cursor = 0;
+  uint64_t lost = 0;
+  uint64_t torn = 0;
+  // The slot of the last batch, and its sequence when it was read
+  const ShmRingSlot *current = nullptr;
+  uint64_t current_sequence = 0;
+
+  bool producer_gone() const;
+};
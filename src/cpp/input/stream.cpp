@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "stream.hpp"
+
+// How often blocked reads check whether to stop
+static const int POLL_TIMEOUT_MS = 100;
+
+int listen_tcp(const std::string &port) {
+  struct addrinfo hints, *servinfo;
+  memset(&hints, 0, sizeof hints);
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  int rv;
+  if ((rv = getaddrinfo(NULL, port.c_str(), &hints, &servinfo)) != 0) {
+    throw std::runtime_error(std::string("getaddrinfo: ") + gai_strerror(rv));
+  }
+  const int sockfd = socket(servinfo->ai_family, servinfo->ai_socktype,
+                            servinfo->ai_protocol);
+  const int on = 1;
+  if (sockfd == -1 ||
+      setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1 ||
+      bind(sockfd, servinfo->ai_addr, servinfo->ai_addrlen) == -1 ||
+      listen(sockfd, 1) == -1) {
+    const int error = errno;
+    freeaddrinfo(servinfo);
+    if (sockfd != -1) {
+      close(sockfd);
+    }
+    throw std::runtime_error("Failed to listen on port " + port + ": " +
+                             strerror(error));
+  }
+  freeaddrinfo(servinfo);
+  return sockfd;
+}
+
+int listen_unix(const std::string &path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Unix socket path too long: " + path);
+  }
+  memcpy(address.sun_path, path.c_str(), path.size());
+  unlink(path.c_str());
+  const int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sockfd == -1 ||
+      bind(sockfd, (struct sockaddr *)&address, sizeof(address)) == -1 ||
+      listen(sockfd, 1) == -1) {
+    const int error = errno;
+    if (sockfd != -1) {
+      close(sockfd);
+    }
+    throw std::runtime_error("Failed to listen on " + path + ": " +
+                             strerror(error));
+  }
+  return sockfd;
+}
+
+int accept_stream(int listener, const std::atomic<bool> &running) {
+  struct pollfd fd = {listener, POLLIN, 0};
+  while (running.load()) {
+    if (poll(&fd, 1, POLL_TIMEOUT_MS) <= 0) {
+      continue;
+    }
+    const int sockfd = accept(listener, NULL, NULL);
+    if (sockfd != -1) {
+      return sockfd;
+    } else if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+      throw std::runtime_error(std::string("Failed to accept connection: ") +
+                               strerror(errno));
+    }
+  }
+  return -1;
+}
+
+bool FrameReader::read(std::vector<AER::Event> &events,
+                       const std::atomic<bool> &running) {
+  while (remaining == 0) {
+    StreamFrameHeader header;
+    if (!read_exact(&header, sizeof(header), running, true)) {
+      return false;
+    }
+    if (!header.valid()) {
+      throw std::runtime_error("Malformed stream frame");
+    }
+    remaining = header.events;
+    received_frames++;
+  }
+  events.resize(std::min(remaining, max_events));
+  if (!read_exact(events.data(), events.size() * sizeof(AER::Event), running,
+                  false)) {
+    return false;
+  }
+  remaining -= events.size();
+  return true;
+}
+
+// Fills a buffer from the socket, in as few reads as the sender allows. Only
+// the start of a frame may meet the end of the stream.
+bool FrameReader::read_exact(void *data, size_t size,
+                             const std::atomic<bool> &running,
+                             bool start_of_frame) {
+  auto *bytes = static_cast<uint8_t *>(data);
+  size_t received = 0;
+  struct pollfd fd = {sockfd, POLLIN, 0};
+  while (received < size) {
+    if (!running.load()) {
+      return false;
+    }
+    const ssize_t count =
+        recv(sockfd, bytes + received, size - received, MSG_DONTWAIT);
+    if (count > 0) {
+      received += count;
+      received_bytes += count;
+    } else if (count == 0) {
+      if (start_of_frame && received == 0) {
+        return false;
+      }
+      throw std::runtime_error("Stream ended within a frame");
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      poll(&fd, 1, POLL_TIMEOUT_MS);
+    } else if (errno != EINTR) {
+      throw std::runtime_error(std::string("Failed to receive events: ") +
+                               strerror(errno));
+    }
+  }
+  return true;
+}
+
+Generator<AER::Event> open_stream(int listener, std::atomic<bool> &runFlag) {
+  std::vector<AER::Event> events;
+  int sockfd;
+  while ((sockfd = accept_stream(listener, runFlag)) != -1) {
+    FrameReader reader(sockfd);
+    try {
+      while (reader.read(events, runFlag)) {
+        for (const auto &event : events) {
+          co_yield event;
+        }
+      }
+    } catch (const std::runtime_error &e) {
+      std::cerr << e.what() << std::endl;
+    }
+    close(sockfd);
+  }
+  close(listener);
+}
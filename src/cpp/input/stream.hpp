@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../aer.hpp"
+#include "../generator.hpp"
+#include "../stream_protocol.hpp"
+
+/// Listens for stream connections on a TCP port of all interfaces
+/// @throws std::runtime_error if the port cannot be bound
+int listen_tcp(const std::string &port);
+/// Listens for stream connections on a Unix domain socket at a path,
+/// replacing a socket file left there
+/// @throws std::runtime_error if the path cannot be bound
+int listen_unix(const std::string &path);
+/// Waits for the next connection, or returns -1 once running turns false
+int accept_stream(int listener, const std::atomic<bool> &running);
+
+/**
+ * Reads frames of events from a connected stream socket. The events of a
+ * frame land directly in the memory of the vector they are read into, up to
+ * max_events at a time, so readers bound the batches they handle.
+ */
+class FrameReader {
+public:
+  const size_t max_events;
+
+  explicit FrameReader(int sockfd,
+                       size_t max_events = StreamFrameHeader::MAX_EVENTS)
+      : max_events(max_events), sockfd(sockfd) {}
+
+  /**
+   * Reads the next events of the current frame, or of the next frame,
+   * replacing the events of the vector.
+   *
+   * @return False at the end of the stream, or once running turns false
+   * @throws std::runtime_error if the sender breaks the frame format
+   */
+  bool read(std::vector<AER::Event> &events, const std::atomic<bool> &running);
+  uint64_t frames() const { return received_frames; }
+  uint64_t bytes() const { return received_bytes; }
+
+private:
+  const int sockfd;
+  // Events of the current frame not yet read
+  size_t remaining = 0;
+  uint64_t received_frames = 0;
+  uint64_t received_bytes = 0;
+
+  bool read_exact(void *data, size_t size, const std::atomic<bool> &running,
+                  bool start_of_frame);
+};
+
+/// Streams the events of the connections to a listening socket, one
+/// connection after another. Closes the listener when done.
+Generator<AER::Event> open_stream(int listener, std::atomic<bool> &runFlag);
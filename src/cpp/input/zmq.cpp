@@ -1,48 +1,86 @@
 #include <atomic>
-#include <zmq.hpp>
 #include <iostream>
+#include <memory>
+#include <zmq.hpp>
 
 #include "input/zmq.hpp"
 
-Generator<AER::Event> open_zmq(const std::string socket, std::atomic<bool>& runFlag) {
-  zmq::context_t ctx;
-  zmq::socket_t sock(ctx, zmq::socket_type::xsub);
-  try {
-    sock.set(zmq::sockopt::linger, 0);
-    sock.connect(socket);
-    auto header = std::string(&ZMQ_SUBSCRIBE_HEADER, 1);
-    auto message = zmq::message_t{header.c_str(), header.size()};
-    sock.send(message, zmq::send_flags::none);
-  } catch (std::exception e) {
-    std::cout << "Failed to connect to ZMQ socket " << socket << ": " << e.what() << std::endl;
-  }
+ZMQReader::ZMQReader(const std::string &address)
+    : socket(context, zmq::socket_type::xsub) {
+  socket.set(zmq::sockopt::linger, 0);
+  socket.connect(address);
+  socket.send(zmq::buffer(&ZMQ_SUBSCRIBE_HEADER, 1), zmq::send_flags::none);
+}
 
+bool ZMQReader::read(std::span<const AER::Event> &events,
+                     std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
   zmq::pollitem_t items[] = {
-    {sock.handle(), 0, ZMQ_POLLIN, 0},
+      {socket.handle(), 0, ZMQ_POLLIN, 0},
   };
-  zmq::message_t message;
-  while (runFlag.load()) {
-    zmq::poll(&items[0], sizeof(items) / sizeof(items[0]));
-    if (!(items[0].revents & ZMQ_POLLIN)) { // No data to receive
+  while (true) {
+    if (!socket.recv(topic, zmq::recv_flags::dontwait)) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0) {
+        return false;
+      }
+      zmq::poll(items, 1, left);
       continue;
-    } 
+    }
+    if (!topic.more()) {
+      continue;
+    }
+    // The parts of a message arrive together, so the events are there
+    (void)socket.recv(message, zmq::recv_flags::none);
+    // Skip any parts we do not know
+    zmq::message_t rest;
+    while (socket.get(zmq::sockopt::rcvmore) != 0) {
+      (void)socket.recv(rest, zmq::recv_flags::none);
+    }
 
-    auto rc = sock.recv(message);
-    if (sock.get(zmq::sockopt::rcvmore) != 0) {
-      const std::string header = message.to_string();
-      if (header == "V") {
-        auto rc2 = sock.recv(message);
-        if (rc2.has_value()) {
-          const auto* const dataPtr = message.data<const DvsEvent>();
-          const std::size_t size = message.size() / sizeof(DvsEvent);
-          const auto events = std::vector(dataPtr, dataPtr + size);
-          for (const auto event : events) {
-            co_yield {event.timestamp, static_cast<uint16_t>(event.x), 
-            static_cast<uint16_t>(event.y), static_cast<bool>(event.polarity)};
-          }
-        }
+    const std::string_view name = topic.to_string_view();
+    if (name == ZMQ_EVENTS_TOPIC &&
+        message.size() % sizeof(AER::Event) == 0) {
+      events = {message.data<const AER::Event>(),
+                message.size() / sizeof(AER::Event)};
+    } else if (name == ZMQ_DVS_TOPIC) {
+      const auto *input = message.data<const DvsEvent>();
+      decoded.resize(message.size() / sizeof(DvsEvent));
+      for (size_t i = 0; i < decoded.size(); i++) {
+        decoded[i] = {input[i].timestamp, static_cast<uint16_t>(input[i].x),
+                      static_cast<uint16_t>(input[i].y), input[i].polarity};
       }
+      events = decoded;
+    } else {
+      continue;
+    }
+    received_messages++;
+    if (!events.empty()) {
+      return true;
+    }
+  }
+}
+
+Generator<AER::Event> open_zmq(const std::string socket,
+                               std::atomic<bool> &runFlag) {
+  std::unique_ptr<ZMQReader> reader;
+  try {
+    reader = std::make_unique<ZMQReader>(socket);
+  } catch (const zmq::error_t &e) {
+    std::cout << "Failed to connect to ZMQ socket " << socket << ": "
+              << e.what() << std::endl;
+    co_return;
+  }
+
+  std::span<const AER::Event> events;
+  while (runFlag.load()) {
+    // Wake up now and then to see whether to stop
+    if (!reader->read(events, std::chrono::milliseconds(100))) {
+      continue;
+    }
+    for (AER::Event event : events) {
+      co_yield event;
     }
   }
-  sock.close();
-}
\ No newline at end of file
+}
@@ -1,14 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <zmq.hpp>
+
 #include "../aer.hpp"
 #include "../generator.hpp"
+#include "../zmq_protocol.hpp"
 
-struct DvsEvent {
-  bool polarity;
-  uint8_t y;
-  uint8_t x;
-  uint32_t timestamp;
-};
+/**
+ * Receives batches of events from a ZMQ publisher, either AER::Events from
+ * `output zmq` or DvsEvents from a SynSense Speck. AER::Events are read where
+ * they lie in the message, and DvsEvents are decoded straight out of it into
+ * one batch that is reused for every message.
+ */
+class ZMQReader {
+public:
+  /// Connects to a publisher and subscribes to all its messages
+  /// @throws zmq::error_t if the address cannot be connected to
+  explicit ZMQReader(const std::string &address);
 
+  /**
+   * Waits for the next message of events and points the events at it. They
+   * stay valid until the next read.
+   *
+   * @return False if no events arrived within the timeout
+   */
+  bool read(std::span<const AER::Event> &events,
+            std::chrono::milliseconds timeout);
+  uint64_t messages() const { return received_messages; }
 
-constexpr char ZMQ_SUBSCRIBE_HEADER = 1;
+private:
+  zmq::context_t context;
+  zmq::socket_t socket;
+  zmq::message_t topic;
+  zmq::message_t message;
+  std::vector<AER::Event> decoded;
+  uint64_t received_messages = 0;
+};
 
-Generator<AER::Event> open_zmq(const std::string socket, std::atomic<bool>& runFlag);
\ No newline at end of file
+Generator<AER::Event> open_zmq(const std::string socket,
+                               std::atomic<bool> &runFlag);
@@ -0,0 +1,159 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../futex.hpp"
+#include "dvs_to_shm.hpp"
+
+template <typename T>
+DVSToShm<T>::DVSToShm(const std::string &name, uint32_t slots,
+                      uint32_t batch_size, bool print_stats)
+    : name(shm_object_name(name)), slots(slots), batch_size(batch_size),
+      print_stats(print_stats) {
+  // Consumers keep a slot clear of the one being written
+  if (slots < 2) {
+    throw std::invalid_argument("Shared memory rings hold at least 2 batches");
+  }
+  if (batch_size == 0) {
+    throw std::invalid_argument("Shared memory batches hold at least 1 event");
+  }
+  // Consumers of an earlier ring keep their mapping until they see it close
+  shm_unlink(this->name.c_str());
+  const int fd =
+      shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to create shared memory " + this->name +
+                             ": " + strerror(errno));
+  }
+  const size_t slot_bytes = ShmRingHeader::slot_bytes_for(batch_size);
+  mapped_bytes = sizeof(ShmRingHeader) + slots * slot_bytes;
+  void *memory = MAP_FAILED;
+  if (ftruncate(fd, mapped_bytes) == 0) {
+    memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0);
+  }
+  const int error = errno;
+  ::close(fd);
+  if (memory == MAP_FAILED) {
+    shm_unlink(this->name.c_str());
+    throw std::runtime_error("Failed to map shared memory " + this->name +
+                             ": " + strerror(error));
+  }
+  // The object starts out zeroed, so only the layout is left to fill in
+  header = static_cast<ShmRingHeader *>(memory);
+  header->version = ShmRingHeader::VERSION;
+  header->slots = slots;
+  header->slot_events = batch_size;
+  header->slot_bytes = slot_bytes;
+  header->producer.store(getpid());
+  header->magic.store(ShmRingHeader::MAGIC, std::memory_order_release);
+}
+
+template <typename T> DVSToShm<T>::~DVSToShm() { close(); }
+
+// Fills batches in place and publishes each once full
+template <typename T> void DVSToShm<T>::stream(Generator<T> &input_generator) {
+  last_report = std::chrono::steady_clock::now();
+  AER::Event *batch = claim();
+  uint32_t events = 0;
+  for (AER::Event event : input_generator) {
+    batch[events++] = event;
+    if (events == batch_size) {
+      publish(events);
+      batch = claim();
+      events = 0;
+    }
+  }
+  if (events > 0) {
+    publish(events);
+  }
+  printf("Sent a total of %lu events\n", sent_events.load());
+}
+
+// Marks the slot of the next batch as being written, so consumers still
+// reading the batch it held can tell
+template <typename T> AER::Event *DVSToShm<T>::claim() {
+  ShmRingSlot *slot = ring_slot(header, next_batch);
+  slot->sequence.store(2 * next_batch + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  return slot->data();
+}
+
+template <typename T> void DVSToShm<T>::publish(uint32_t events) {
+  ShmRingSlot *slot = ring_slot(header, next_batch);
+  slot->events = events;
+  slot->sequence.store(2 * next_batch + 2, std::memory_order_release);
+  next_batch++;
+  header->published.store(next_batch);
+  // Consumers announce that they sleep before they check for batches, so
+  // either they see this batch or we see them
+  if (header->waiters.load() > 0) {
+    header->wakeups.fetch_add(1);
+    futex_wake_all(header->wakeups);
+  }
+  sent_events += events;
+  if (print_stats) {
+    report();
+  }
+}
+
+template <typename T> ShmOutputStats DVSToShm<T>::stats() const {
+  ShmOutputStats stats;
+  stats.events = sent_events.load();
+  stats.batches = next_batch;
+  if (!header) {
+    return stats;
+  }
+  for (const auto &consumer : header->consumers) {
+    const int32_t pid = consumer.pid.load();
+    if (pid != 0) {
+      const uint64_t cursor = consumer.cursor.load();
+      stats.consumers.push_back({pid, next_batch - std::min(cursor, next_batch),
+                                 consumer.lost.load()});
+    }
+  }
+  return stats;
+}
+
+// Prints the rates of the last second and the lag of each consumer, once a
+// second has passed
+template <typename T> void DVSToShm<T>::report() {
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_report < std::chrono::seconds(1)) {
+    return;
+  }
+  const double seconds =
+      std::chrono::duration<double>(now - last_report).count();
+  const ShmOutputStats current = stats();
+  fprintf(stderr, "%.0f events/s, %.0f batches/s",
+          (current.events - reported.events) / seconds,
+          (current.batches - reported.batches) / seconds);
+  for (const auto &consumer : current.consumers) {
+    fprintf(stderr, ", consumer %d %lu batches behind (%lu lost)",
+            consumer.pid, consumer.lag, consumer.lost_batches);
+  }
+  fprintf(stderr, "\n");
+  last_report = now;
+  reported = current;
+}
+
+// Tells the consumers that no more batches follow, and removes the object.
+// Consumers keep their mapping until they let go of it.
+template <typename T> void DVSToShm<T>::close() {
+  if (!header) {
+    return;
+  }
+  header->closed.store(1);
+  header->wakeups.fetch_add(1);
+  futex_wake_all(header->wakeups);
+  munmap(header, mapped_bytes);
+  header = nullptr;
+  shm_unlink(name.c_str());
+}
+
+template class DVSToShm<AER::Event>;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../aer.hpp"
+#include "../generator.hpp"
+#include "../shm_ring.hpp"
+
+/// How far a consumer of a shared memory ring is behind, in batches
+struct ShmConsumerStats {
+  int32_t pid = 0;
+  uint64_t lag = 0;
+  uint64_t lost_batches = 0;
+};
+
+/// What a DVSToShm producer published, and how its consumers keep up
+struct ShmOutputStats {
+  uint64_t events = 0;
+  uint64_t batches = 0;
+  std::vector<ShmConsumerStats> consumers;
+};
+
+/**
+ * Publishes events in batches to a ring in POSIX shared memory, which
+ * consumers in other processes read in place. The producer never waits for
+ * them, so a slow consumer loses batches rather than holding up the input.
+ */
+template <typename T> class DVSToShm {
+public:
+  const std::string name;
+  const uint32_t slots;
+  const uint32_t batch_size;
+
+  /// Creates the shared memory object, replacing one left by an earlier
+  /// producer of the same name
+  /// @throws std::invalid_argument if the ring holds fewer than two batches
+  /// @throws std::runtime_error if the object cannot be created
+  DVSToShm(const std::string &name, uint32_t slots = 1024,
+           uint32_t batch_size = 1024, bool print_stats = false);
+  /// Tells the consumers the stream ended, and removes the object
+  ~DVSToShm();
+
+  void stream(Generator<T> &input_generator);
+  /// Room for the events of the next batch, to be written in place
+  AER::Event *claim();
+  /// Publishes the first events of the claimed batch
+  void publish(uint32_t events);
+  void close();
+  ShmOutputStats stats() const;
+
+private:
+  ShmRingHeader *header = nullptr;
+  size_t mapped_bytes = 0;
+  const bool print_stats;
+
+  uint64_t next_batch = 0;
+  std::atomic<uint64_t> sent_events = 0;
+  std::chrono::steady_clock::time_point last_report;
+  ShmOutputStats reported;
+
+  void report();
+};
@@ -0,0 +1,333 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "dvs_to_stream.hpp"
+
+#ifdef MSG_ZEROCOPY
+static constexpr int ZEROCOPY_FLAG = MSG_ZEROCOPY;
+#else
+static constexpr int ZEROCOPY_FLAG = 0;
+#endif
+
+int connect_tcp(const std::string &host, const std::string &port) {
+  struct addrinfo hints, *servinfo;
+  memset(&hints, 0, sizeof hints);
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int rv;
+  if ((rv = getaddrinfo(host.c_str(), port.c_str(), &hints, &servinfo)) !=
+      0) {
+    throw std::runtime_error(std::string("getaddrinfo: ") + gai_strerror(rv));
+  }
+  int sockfd = -1;
+  int error = 0;
+  for (auto *p = servinfo; p != NULL; p = p->ai_next) {
+    if ((sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) ==
+        -1) {
+      error = errno;
+      continue;
+    }
+    if (connect(sockfd, p->ai_addr, p->ai_addrlen) == 0) {
+      break;
+    }
+    error = errno;
+    close(sockfd);
+    sockfd = -1;
+  }
+  freeaddrinfo(servinfo);
+  if (sockfd == -1) {
+    throw std::runtime_error("Failed to connect to " + host + ":" + port +
+                             ": " + strerror(error));
+  }
+  // Frames are whole messages, which should not wait for the next one
+  const int on = 1;
+  setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return sockfd;
+}
+
+int connect_unix(const std::string &path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Unix socket path too long: " + path);
+  }
+  memcpy(address.sun_path, path.c_str(), path.size());
+  const int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sockfd == -1) {
+    throw std::runtime_error(std::string("Failed to create socket: ") +
+                             strerror(errno));
+  }
+  if (connect(sockfd, (struct sockaddr *)&address, sizeof(address)) == -1) {
+    const int error = errno;
+    close(sockfd);
+    throw std::runtime_error("Failed to connect to " + path + ": " +
+                             strerror(error));
+  }
+  return sockfd;
+}
+
+template <typename T>
+DVSToStream<T>::DVSToStream(int sockfd, uint32_t buffer_size, bool zerocopy,
+                            bool print_stats)
+    : buffer_size(buffer_size), sockfd(sockfd), use_zerocopy(false),
+      print_stats(print_stats) {
+  if (buffer_size == 0 || buffer_size > StreamFrameHeader::MAX_EVENTS) {
+    close(sockfd);
+    throw std::invalid_argument(
+        "Stream frames must hold between 1 and " +
+        std::to_string(StreamFrameHeader::MAX_EVENTS) + " events");
+  }
+#ifdef SO_ZEROCOPY
+  // Only TCP sockets of recent kernels send from our memory
+  const int on = 1;
+  use_zerocopy = zerocopy && ZEROCOPY_FLAG != 0 &&
+                 setsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY, &on,
+                            sizeof(on)) == 0;
+#endif
+  if (zerocopy && !use_zerocopy) {
+    fprintf(stderr, "Zero-copy sends unavailable, copying events instead\n");
+  }
+}
+
+template <typename T> DVSToStream<T>::~DVSToStream() { closesocket(); }
+
+// Sends frames of events, which zero-copy sends keep in flight until the
+// kernel is done with them
+template <typename T>
+void DVSToStream<T>::stream(Generator<T> &input_generator) {
+  frames.assign(use_zerocopy ? ZEROCOPY_FRAMES : 1, Frame{});
+  for (auto &frame : frames) {
+    frame.events.reserve(buffer_size);
+  }
+  last_report = std::chrono::steady_clock::now();
+
+  size_t current = 0;
+  for (AER::Event event : input_generator) {
+    frames[current].events.push_back(event);
+    if (frames[current].events.size() >= buffer_size) {
+      send_frame(frames[current]);
+      current = (current + 1) % frames.size();
+      release(frames[current]);
+    }
+  }
+  if (!frames[current].events.empty()) {
+    send_frame(frames[current]);
+  }
+  for (auto &frame : frames) {
+    release(frame);
+  }
+  printf("Sent a total of %lu events\n", sent_events.load());
+}
+
+// Writes the header and events of a frame with as few system calls as the
+// socket buffer allows. The socket never blocks in a send, so the time a
+// slow receiver holds us up shows as stalls.
+template <typename T> void DVSToStream<T>::send_frame(Frame &frame) {
+  frame.header.events = frame.events.size();
+  const struct iovec parts[2] = {
+      {&frame.header, sizeof(frame.header)},
+      {frame.events.data(), frame.header.payload_bytes()}};
+  const size_t total = parts[0].iov_len + parts[1].iov_len;
+  int flags =
+      MSG_NOSIGNAL | MSG_DONTWAIT | (use_zerocopy ? ZEROCOPY_FLAG : 0);
+
+  size_t written = 0;
+  while (written < total) {
+    // Skip what earlier partial writes sent
+    struct iovec pending[2];
+    size_t count = 0;
+    size_t skip = written;
+    for (const auto &part : parts) {
+      if (skip >= part.iov_len) {
+        skip -= part.iov_len;
+        continue;
+      }
+      pending[count++] = {static_cast<uint8_t *>(part.iov_base) + skip,
+                          part.iov_len - skip};
+      skip = 0;
+    }
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = pending;
+    message.msg_iovlen = count;
+
+    const ssize_t sent = sendmsg(sockfd, &message, flags);
+    syscalls++;
+    if (sent == -1) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        wait_writable();
+        continue;
+      } else if (errno == ENOBUFS && (flags & ZEROCOPY_FLAG)) {
+        // The kernel pins no more of our memory until earlier sends finish
+        if (zerocopy_completed != zerocopy_sends) {
+          reap_completions(true);
+        } else {
+          flags &= ~ZEROCOPY_FLAG;
+        }
+        continue;
+      }
+      throw std::runtime_error(std::string("Failed to send events: ") +
+                               strerror(errno));
+    }
+    if (flags & ZEROCOPY_FLAG) {
+      frame.in_flight = true;
+      frame.last_send = zerocopy_sends++;
+    }
+    written += sent;
+  }
+  sent_events += frame.events.size();
+  sent_frames++;
+  sent_bytes += total;
+  if (print_stats) {
+    report();
+  }
+}
+
+// Waits for room in the socket buffer, reading zero-copy completions that
+// arrive meanwhile
+template <typename T> void DVSToStream<T>::wait_writable() {
+  stalls++;
+  const auto start = std::chrono::steady_clock::now();
+  struct pollfd fd = {sockfd, POLLOUT, 0};
+  while (true) {
+    if (poll(&fd, 1, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("Failed to poll socket: ") +
+                               strerror(errno));
+    }
+    if (fd.revents & (POLLOUT | POLLHUP)) {
+      break;
+    }
+    // Errors other than completions surface in the next send
+    if ((fd.revents & POLLERR) && !(use_zerocopy && reap_completions(false))) {
+      break;
+    }
+  }
+  stall_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+}
+
+// Reads the notifications of the kernel about the zero-copy sends it is done
+// with, waiting for one if asked to
+template <typename T> bool DVSToStream<T>::reap_completions(bool block) {
+  bool reaped = false;
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+  while (true) {
+    char control[128];
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(sockfd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        throw std::runtime_error(
+            std::string("Failed to read zero-copy completions: ") +
+            strerror(errno));
+      }
+      if (reaped || !block) {
+        return reaped;
+      }
+      // Notifications on the error queue wake polls with POLLERR
+      struct pollfd fd = {sockfd, 0, 0};
+      if (poll(&fd, 1, -1) == 1 && !(fd.revents & POLLERR)) {
+        throw std::runtime_error("Connection closed during zero-copy send");
+      }
+      int error = 0;
+      socklen_t length = sizeof(error);
+      getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length);
+      if (error != 0) {
+        throw std::runtime_error(std::string("Failed to send events: ") +
+                                 strerror(error));
+      }
+      continue;
+    }
+    for (auto *cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&message, cmsg)) {
+      const auto *error = (const struct sock_extended_err *)CMSG_DATA(cmsg);
+      if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      // Notifications cover the sends from ee_info to ee_data
+      if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        copied_sends += error->ee_data - error->ee_info + 1;
+      }
+      if (int32_t(error->ee_data + 1 - zerocopy_completed) > 0) {
+        zerocopy_completed = error->ee_data + 1;
+      }
+      reaped = true;
+    }
+  }
+#endif
+  return reaped;
+}
+
+// Waits until the kernel is done with the events of a frame, and empties it
+template <typename T> void DVSToStream<T>::release(Frame &frame) {
+  while (frame.in_flight &&
+         int32_t(zerocopy_completed - frame.last_send) <= 0) {
+    reap_completions(true);
+  }
+  frame.in_flight = false;
+  frame.events.clear();
+}
+
+template <typename T> StreamOutputStats DVSToStream<T>::stats() const {
+  return {sent_events.load(), sent_frames.load(), sent_bytes.load(),
+          syscalls.load(),    stalls.load(),      stall_us.load(),
+          copied_sends.load()};
+}
+
+// Prints the rates of the last second, once a second has passed
+template <typename T> void DVSToStream<T>::report() {
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_report < std::chrono::seconds(1)) {
+    return;
+  }
+  const double seconds =
+      std::chrono::duration<double>(now - last_report).count();
+  const StreamOutputStats current = stats();
+  fprintf(stderr,
+          "%.0f events/s, %.0f frames/s, %.0f bytes/s, %.0f syscalls/s, "
+          "%.0f stalls/s, stalled %.1f%% of the time",
+          (current.events - reported.events) / seconds,
+          (current.frames - reported.frames) / seconds,
+          (current.bytes - reported.bytes) / seconds,
+          (current.syscalls - reported.syscalls) / seconds,
+          (current.stalls - reported.stalls) / seconds,
+          (current.stall_us - reported.stall_us) / seconds / 1e4);
+  if (use_zerocopy) {
+    fprintf(stderr, ", %.0f copied sends/s",
+            (current.copied_sends - reported.copied_sends) / seconds);
+  }
+  fprintf(stderr, "\n");
+  last_report = now;
+  reported = current;
+}
+
+// Close the socket
+template <typename T> void DVSToStream<T>::closesocket() {
+  if (sockfd != -1) {
+    close(sockfd);
+    sockfd = -1;
+  }
+}
+
+template class DVSToStream<AER::Event>;
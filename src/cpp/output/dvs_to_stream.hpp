@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "../aer.hpp"
+#include "../generator.hpp"
+#include "../stream_protocol.hpp"
+
+/**
+ * What a DVSToStream sender put on the socket. Stalls count the times the
+ * socket buffer was full because the receiver fell behind, and stall time
+ * the time spent waiting for it to drain. Zero-copy sends that the kernel
+ * copied after all count as copied.
+ */
+struct StreamOutputStats {
+  uint64_t events = 0;
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  uint64_t syscalls = 0;
+  uint64_t stalls = 0;
+  uint64_t stall_us = 0;
+  uint64_t copied_sends = 0;
+};
+
+/// Connects a stream socket to a TCP host and port
+/// @throws std::runtime_error if no address of the host accepts
+int connect_tcp(const std::string &host, const std::string &port);
+/// Connects a stream socket to a Unix domain socket at a path
+/// @throws std::runtime_error if nothing listens there
+int connect_unix(const std::string &path);
+
+/**
+ * Sends events over a connected TCP or Unix domain socket, in frames of up
+ * to buffer_size events. Each frame leaves with one gathered write of its
+ * header and events, without copying them into a packet first.
+ */
+template <typename T> class DVSToStream {
+public:
+  const uint32_t buffer_size;
+  // Frames in flight while the kernel sends them from our memory
+  static const size_t ZEROCOPY_FRAMES = 8;
+
+  /// Takes ownership of a connected socket. Zero-copy sends need a kernel
+  /// and socket supporting MSG_ZEROCOPY, and fall back to copies otherwise.
+  /// @throws std::invalid_argument if frames would hold no or too many events
+  DVSToStream(int sockfd, uint32_t buffer_size = 8192, bool zerocopy = false,
+              bool print_stats = false);
+  ~DVSToStream();
+
+  void stream(Generator<T> &input_generator);
+  void closesocket();
+  bool zerocopy() const { return use_zerocopy; }
+  StreamOutputStats stats() const;
+
+private:
+  // Events of a frame, which zero-copy sends leave alone until the kernel
+  // reports they are sent
+  struct Frame {
+    StreamFrameHeader header;
+    std::vector<AER::Event> events;
+    bool in_flight = false;
+    uint32_t last_send = 0;
+  };
+  std::vector<Frame> frames;
+  int sockfd;
+  bool use_zerocopy;
+  const bool print_stats;
+
+  // Zero-copy sends so far, and the sends the kernel is done with
+  uint32_t zerocopy_sends = 0;
+  uint32_t zerocopy_completed = 0;
+
+  std::atomic<uint64_t> sent_events = 0;
+  std::atomic<uint64_t> sent_frames = 0;
+  std::atomic<uint64_t> sent_bytes = 0;
+  std::atomic<uint64_t> syscalls = 0;
+  std::atomic<uint64_t> stalls = 0;
+  std::atomic<uint64_t> stall_us = 0;
+  std::atomic<uint64_t> copied_sends = 0;
+  std::chrono::steady_clock::time_point last_report;
+  StreamOutputStats reported;
+
+  void send_frame(Frame &frame);
+  void wait_writable();
+  bool reap_completions(bool block);
+  void release(Frame &frame);
+  void report();
+};
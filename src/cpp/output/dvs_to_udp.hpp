@@ -1,34 +1,141 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 // socket programming
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "../aer.hpp"
 #include "../generator.hpp"
+#include "../pacer.hpp"
+#include "../udp_protocol.hpp"
+#include "udp_pacing.hpp"
+
+/**
+ * What a DVSToUDP sender put on the wire. With segmentation offload, one
+ * system call can carry many packets. Packets and bytes count every copy
+ * sent to each destination. Paced senders drop packets when their queue
+ * overflows, if their policy says so.
+ */
+struct UDPOutputStats {
+  uint64_t events = 0;
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+  uint64_t syscalls = 0;
+  uint64_t dropped_events = 0;
+  uint64_t dropped_packets = 0;
+};
+
+/// A host and port to send packets to, which may be a multicast group
+struct UDPDestination {
+  std::string host;
+  std::string port;
+
+  /// Reads "host", "host:port" or "[IPv6 address]:port"
+  /// @throws std::invalid_argument if an IPv6 address is not closed
+  static UDPDestination parse(const std::string &address,
+                              const std::string &default_port);
+};
 
 template <typename T> class DVSToUDP {
 public:
-  int sockfd = -1;
-  std::string serverport;
-  std::string IPAdress;
-  struct addrinfo *p = NULL;
+  std::vector<UDPDestination> destinations;
+  // Events sent with one system call, and events per packet
   uint32_t buffer_size;
+  uint32_t packet_size;
 
-  static const uint16_t UDP_max_bytesize = 512;
+  // Largest payload of a UDP datagram over IPv4
+  static const uint32_t UDP_max_bytesize = 65507;
+  // Most messages sendmmsg accepts at once, and most segments the kernel
+  // splits one message into
+  static const uint32_t MAX_MESSAGES = 1024;
+  static const uint32_t MAX_SEGMENTS = 64;
 
-  DVSToUDP(uint32_t bfsize, std::string port, std::string IP);
+  DVSToUDP(uint32_t bfsize, std::string port, std::string IP,
+           uint32_t packet_size = 128, bool print_stats = false);
+  /// Sends every packet to all destinations. Packets to multicast groups
+  /// pass at most multicast_hops routers.
+  DVSToUDP(uint32_t bfsize, std::vector<UDPDestination> destinations,
+           uint32_t packet_size = 128, bool print_stats = false,
+           int multicast_hops = 1);
+  ~DVSToUDP();
 
-  void stream(Generator<T> &input_generator, bool include_timestamp);
+  /// Limits the rate of the packets sent by the following streams. Paced
+  /// packets are queued and sent from a thread of their own.
+  void set_pacing(const UDPPacing &pacing) { this->pacing = pacing; }
+  void stream(Generator<T> &input_generator,
+              UDPEncoding encoding = UDPEncoding::SPIF);
   void closesocket();
-};
\ No newline at end of file
+  UDPOutputStats stats() const;
+
+private:
+  // A socket for the destinations of one address family. Its kernel splits
+  // messages into packets if it supports UDP GSO.
+  struct Socket {
+    int fd = -1;
+    int family;
+    bool use_gso = false;
+    std::vector<struct sockaddr_storage> addresses;
+    std::vector<socklen_t> address_lengths;
+  };
+  std::vector<Socket> sockets;
+  const bool print_stats;
+
+  // Packets waiting for the sending thread of a paced stream, and the error
+  // that stopped it
+  UDPPacing pacing;
+  std::unique_ptr<PacketQueue> queue;
+  std::thread sender;
+  std::exception_ptr send_error;
+
+  // Encoded packets of the current batch, and the messages that send them
+  size_t packet_bytes = 0;
+  std::vector<uint8_t> payload;
+  std::vector<struct mmsghdr> messages;
+  std::vector<struct iovec> iovecs;
+  // Events of the packed packet being filled, and the lengths of the packed
+  // packets in the batch
+  std::vector<AER::Event> pending;
+  std::vector<uint8_t> scratch;
+  std::vector<size_t> packet_lengths;
+
+  std::atomic<uint64_t> sent_events = 0;
+  std::atomic<uint64_t> sent_packets = 0;
+  std::atomic<uint64_t> sent_bytes = 0;
+  std::atomic<uint64_t> syscalls = 0;
+  std::chrono::steady_clock::time_point last_report;
+  UDPOutputStats reported;
+
+  Socket &socket_for(int family, int multicast_hops);
+  void stream_fixed(Generator<T> &input_generator, bool include_timestamp);
+  void stream_packed(Generator<T> &input_generator, bool lz4);
+  bool enable_gso(int sockfd, uint32_t packet_bytes);
+  void prepare_message(size_t i, Socket &socket, size_t address,
+                       uint8_t *data, size_t bytes);
+  bool send_messages(const Socket &socket, size_t count);
+  bool send_segmented(Socket &socket, size_t batch_bytes);
+  void send_batch(size_t bytes, size_t events);
+  void send_packets(size_t events);
+  void enqueue(const uint8_t *data, size_t bytes, size_t events);
+  void send_paced();
+  void send_queued(const QueuedPacket *packets, size_t count);
+  void count_sent(size_t events, size_t packets, size_t bytes);
+  void report();
+};
@@ -0,0 +1,87 @@
+#include <stdexcept>
+
+#include <stdio.h>
+
+#include "dvs_to_zmq.hpp"
+
+// Frees batches once ZMQ is done with them, possibly on one of its threads
+static void free_batch(void *data, void *hint) {
+  delete[] static_cast<AER::Event *>(data);
+}
+
+template <typename T>
+DVSToZMQ<T>::DVSToZMQ(const std::string &address, uint32_t batch_size,
+                      bool print_stats)
+    : address(address), batch_size(batch_size),
+      socket(context, zmq::socket_type::pub), print_stats(print_stats) {
+  if (batch_size == 0) {
+    throw std::invalid_argument("ZMQ batches hold at least 1 event");
+  }
+  // Give subscribers a moment to receive the last batches when we close
+  socket.set(zmq::sockopt::linger, 1000);
+  socket.bind(address);
+}
+
+template <typename T> void DVSToZMQ<T>::stream(Generator<T> &input_generator) {
+  last_report = std::chrono::steady_clock::now();
+  AER::Event *batch = new AER::Event[batch_size];
+  uint32_t events = 0;
+  for (AER::Event event : input_generator) {
+    batch[events++] = event;
+    if (events == batch_size) {
+      send(batch, events);
+      batch = new AER::Event[batch_size];
+      events = 0;
+    }
+  }
+  if (events > 0) {
+    send(batch, events);
+  } else {
+    delete[] batch;
+  }
+  printf("Sent a total of %lu events\n", sent_events.load());
+}
+
+template <typename T> void DVSToZMQ<T>::send(AER::Event *batch,
+                                             uint32_t events) {
+  // The message owns the batch from here on, and frees it even if unsent
+  zmq::message_t message(batch, events * sizeof(AER::Event), free_batch);
+  const auto flags = zmq::send_flags::dontwait;
+  // Once the topic is queued, ZMQ queues the rest of the message with it
+  if (socket.send(zmq::buffer(ZMQ_EVENTS_TOPIC), zmq::send_flags::sndmore |
+                                                     flags) &&
+      socket.send(message, flags)) {
+    sent_events += events;
+    sent_batches++;
+  } else {
+    dropped_events += events;
+    dropped_batches++;
+  }
+  if (print_stats) {
+    report();
+  }
+}
+
+template <typename T> ZMQOutputStats DVSToZMQ<T>::stats() const {
+  return {sent_events.load(), sent_batches.load(), dropped_events.load(),
+          dropped_batches.load()};
+}
+
+// Prints the rates of the last second, once a second has passed
+template <typename T> void DVSToZMQ<T>::report() {
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_report < std::chrono::seconds(1)) {
+    return;
+  }
+  const double seconds =
+      std::chrono::duration<double>(now - last_report).count();
+  const ZMQOutputStats current = stats();
+  fprintf(stderr, "%.0f events/s, %.0f batches/s, %lu batches dropped\n",
+          (current.events - reported.events) / seconds,
+          (current.batches - reported.batches) / seconds,
+          current.dropped_batches - reported.dropped_batches);
+  last_report = now;
+  reported = current;
+}
+
+template class DVSToZMQ<AER::Event>;
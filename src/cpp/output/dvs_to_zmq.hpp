@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <zmq.hpp>
+
+#include "../aer.hpp"
+#include "../generator.hpp"
+#include "../zmq_protocol.hpp"
+
+/// What a DVSToZMQ publisher sent, and what ZMQ refused to queue
+struct ZMQOutputStats {
+  uint64_t events = 0;
+  uint64_t batches = 0;
+  uint64_t dropped_events = 0;
+  uint64_t dropped_batches = 0;
+};
+
+/**
+ * Publishes events in batches on a ZMQ PUB socket, as the two-part messages
+ * that ZMQReader and SpeckInput subscribe to. Batches are handed to ZMQ
+ * without copying, and ZMQ frees them once sent. The publisher never waits
+ * for its subscribers: batches that ZMQ cannot queue are dropped.
+ */
+template <typename T> class DVSToZMQ {
+public:
+  const std::string address;
+  const uint32_t batch_size;
+
+  /// Binds the socket to an address, such as tcp://0.0.0.0:40001
+  /// @throws std::invalid_argument if batches hold no events
+  /// @throws zmq::error_t if the address cannot be bound
+  DVSToZMQ(const std::string &address, uint32_t batch_size = 1024,
+           bool print_stats = false);
+
+  void stream(Generator<T> &input_generator);
+  /// Hands a batch allocated with new[] over to ZMQ, which frees it
+  void send(AER::Event *batch, uint32_t events);
+  ZMQOutputStats stats() const;
+
+private:
+  zmq::context_t context;
+  zmq::socket_t socket;
+  const bool print_stats;
+
+  std::atomic<uint64_t> sent_events = 0;
+  std::atomic<uint64_t> sent_batches = 0;
+  std::atomic<uint64_t> dropped_events = 0;
+  std::atomic<uint64_t> dropped_batches = 0;
+  std::chrono::steady_clock::time_point last_report;
+  ZMQOutputStats reported;
+
+  void report();
+};
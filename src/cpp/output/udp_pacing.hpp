@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/// What a paced sender does with packets that arrive while its queue is full
+enum class OverflowPolicy { Block, DropOldest, DropNewest };
+
+/**
+ * Limits on the packets a DVSToUDP sender puts on the wire. Rates of 0 set
+ * no limit. Up to burst packets may leave back to back after idle time, and
+ * consecutive packets are at least packet_gap apart.
+ */
+struct UDPPacing {
+  double events_per_second = 0;
+  double bytes_per_second = 0;
+  size_t burst = 1;
+  std::chrono::nanoseconds packet_gap{0};
+  // Packets waiting to be sent, beyond which the overflow policy applies
+  size_t queue_packets = 1024;
+  OverflowPolicy overflow = OverflowPolicy::Block;
+
+  bool enabled() const {
+    return events_per_second > 0 || bytes_per_second > 0 ||
+           packet_gap.count() > 0;
+  }
+};
+
+/**
+ * An encoded packet waiting to be sent, and the events it carries.
+ */
+struct QueuedPacket {
+  std::vector<uint8_t> data;
+  size_t events = 0;
+};
+
+/**
+ * Packets handed from the encoding thread to the sending thread of a paced
+ * sender. The queue holds at most a capacity of packets, so the latency it
+ * adds stays bounded unless the policy blocks. Buffers of sent packets are
+ * recycled, so steady streams allocate nothing.
+ */
+class PacketQueue {
+public:
+  const size_t capacity;
+  const OverflowPolicy overflow;
+
+  /// @throws std::invalid_argument if the capacity is 0
+  PacketQueue(size_t capacity, OverflowPolicy overflow)
+      : capacity(capacity), overflow(overflow) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Packet queues must hold a packet");
+    }
+  }
+
+  /**
+   * Queues a copy of a packet, or drops a packet if the queue is full and
+   * the policy says so.
+   *
+   * @return False if the queue was closed
+   */
+  bool push(const uint8_t *data, size_t bytes, size_t events) {
+    std::unique_lock lock{mutex};
+    if (overflow == OverflowPolicy::Block) {
+      not_full.wait(lock,
+                    [this] { return closed || packets.size() < capacity; });
+    }
+    if (closed) {
+      return false;
+    }
+    if (packets.size() >= capacity) {
+      if (overflow == OverflowPolicy::DropNewest) {
+        count_dropped(events);
+        return true;
+      }
+      count_dropped(packets.front().events);
+      spare.push_back(std::move(packets.front().data));
+      packets.pop_front();
+    }
+    QueuedPacket packet;
+    if (!spare.empty()) {
+      packet.data = std::move(spare.back());
+      spare.pop_back();
+    }
+    packet.data.assign(data, data + bytes);
+    packet.events = events;
+    packets.push_back(std::move(packet));
+    not_empty.notify_one();
+    return true;
+  }
+
+  /**
+   * Moves up to max packets out of the queue, waiting for the first. The
+   * buffers of the previous packets in the output are recycled.
+   *
+   * @return False once the queue is closed and empty
+   */
+  bool pop(std::vector<QueuedPacket> &output, size_t max) {
+    std::unique_lock lock{mutex};
+    for (auto &packet : output) {
+      spare.push_back(std::move(packet.data));
+    }
+    output.clear();
+    not_empty.wait(lock, [this] { return closed || !packets.empty(); });
+    while (!packets.empty() && output.size() < max) {
+      output.push_back(std::move(packets.front()));
+      packets.pop_front();
+    }
+    not_full.notify_all();
+    return !output.empty();
+  }
+
+  /// Lets the queued packets drain, and refuses new ones
+  void close() {
+    const std::lock_guard lock{mutex};
+    closed = true;
+    not_empty.notify_all();
+    not_full.notify_all();
+  }
+
+  uint64_t dropped_packets() const {
+    const std::lock_guard lock{mutex};
+    return dropped.packets;
+  }
+  uint64_t dropped_events() const {
+    const std::lock_guard lock{mutex};
+    return dropped.events;
+  }
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<QueuedPacket> packets;
+  std::vector<std::vector<uint8_t>> spare;
+  bool closed = false;
+  struct {
+    uint64_t packets = 0;
+    uint64_t events = 0;
+  } dropped;
+
+  void count_dropped(size_t events) {
+    dropped.packets++;
+    dropped.events += events;
+  }
+};
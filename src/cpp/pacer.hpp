@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "aer.hpp"
+#include "generator.hpp"
+
+/**
+ * How far behind or ahead of their timestamps paced batches of events were
+ * ready. Batches that were ready early waited for their time (lead), while
+ * late batches were released as soon as they were ready (lag).
+ */
+struct PacingStats {
+  uint64_t batches = 0;
+  uint64_t late_batches = 0;
+  double mean_lag_us = 0;
+  double max_lag_us = 0;
+  double mean_lead_us = 0;
+  double max_lead_us = 0;
+};
+
+/**
+ * Blocks until a deadline, or until running turns false. Sleeps overshoot by
+ * tens of microseconds, so the last SPIN_TIME before the deadline is spent
+ * spinning, and shorter waits only spin.
+ */
+inline void wait_until(std::chrono::steady_clock::time_point deadline,
+                       const std::atomic<bool> *running = nullptr) {
+  using clock = std::chrono::steady_clock;
+  constexpr auto SPIN_TIME = std::chrono::microseconds(200);
+  constexpr auto SLEEP_SLICE = std::chrono::milliseconds(50);
+  // Sleep in slices, so long pauses can be interrupted
+  while (clock::now() + SPIN_TIME < deadline) {
+    if (running && !running->load()) {
+      return;
+    }
+    std::this_thread::sleep_until(
+        std::min(deadline - SPIN_TIME, clock::now() + SLEEP_SLICE));
+  }
+  while (clock::now() < deadline) {
+  }
+}
+
+/**
+ * Limits a rate of events or bytes. Tokens accrue at the rate up to the
+ * capacity, which bounds the bursts after idle time, and are spent on what is
+ * sent. Amounts above the capacity may be taken once the bucket is full, and
+ * leave it in debt. A rate of 0 sets no limit.
+ */
+class TokenBucket {
+public:
+  using clock = std::chrono::steady_clock;
+  const double rate;
+  const double capacity;
+
+  /**
+   * @param rate Tokens per second
+   * @param capacity Most tokens the bucket holds
+   * @throws std::invalid_argument if the rate or capacity is negative
+   */
+  TokenBucket(double rate, double capacity)
+      : rate(rate), capacity(capacity), tokens(capacity),
+        updated(clock::now()) {
+    if (!(rate >= 0 && capacity >= 0)) {
+      throw std::invalid_argument("Rates and bursts cannot be negative");
+    }
+  }
+
+  /// Time at which the bucket can afford the amount
+  clock::time_point ready_at(double amount) {
+    const auto now = clock::now();
+    refill(now);
+    const double needed = std::min(amount, capacity) - tokens;
+    if (rate == 0 || needed <= 0) {
+      return now;
+    }
+    return now + std::chrono::duration_cast<clock::duration>(
+                     std::chrono::duration<double>(needed / rate));
+  }
+
+  void take(double amount) {
+    refill(clock::now());
+    tokens -= amount;
+  }
+
+private:
+  double tokens;
+  clock::time_point updated;
+
+  void refill(clock::time_point now) {
+    tokens = std::min(
+        capacity,
+        tokens + rate * std::chrono::duration<double>(now - updated).count());
+    updated = now;
+  }
+};
+
+/**
+ * Releases batches of events at the time of their timestamps, relative to the
+ * first batch and scaled by a speed factor. Waiting sleeps until shortly
+ * before the deadline and spins for the rest, since sleeps overshoot by tens
+ * of microseconds.
+ */
+class Pacer {
+public:
+  static constexpr double MIN_SPEED = 0.1;
+  static constexpr double MAX_SPEED = 100;
+  const double speed;
+  // Duration of one timestamp unit
+  const std::chrono::nanoseconds unit;
+
+  /**
+   * @param speed Playback speed; 2 plays twice as fast as recorded
+   * @param unit Duration of one timestamp unit
+   * @throws std::invalid_argument if the speed is out of range
+   */
+  explicit Pacer(double speed = 1,
+                 std::chrono::nanoseconds unit = std::chrono::microseconds(1))
+      : speed(speed), unit(unit) {
+    if (!(speed >= MIN_SPEED && speed <= MAX_SPEED)) {
+      throw std::invalid_argument("Playback speed must be between 0.1 and 100");
+    }
+  }
+
+  /// Blocks until the event time is due, or until running turns false
+  void pace(uint64_t timestamp,
+            const std::atomic<bool> *running = nullptr) {
+    const auto now = clock::now();
+    if (!origin_event) {
+      origin_real = now;
+      origin_event = timestamp;
+      record(0);
+      return;
+    }
+    const uint64_t elapsed =
+        timestamp > *origin_event ? timestamp - *origin_event : 0;
+    const auto deadline =
+        origin_real + std::chrono::duration_cast<clock::duration>(
+                          std::chrono::duration<double, std::nano>(
+                              elapsed * unit.count() / speed));
+    if (now >= deadline) {
+      record(std::chrono::duration<double, std::micro>(now - deadline).count());
+      return;
+    }
+    record(-std::chrono::duration<double, std::micro>(deadline - now).count());
+    wait_until(deadline, running);
+  }
+
+  PacingStats stats() {
+    const std::lock_guard lock{stats_lock};
+    PacingStats result = totals;
+    const uint64_t early = totals.batches - totals.late_batches;
+    result.mean_lag_us =
+        totals.late_batches ? totals.mean_lag_us / totals.late_batches : 0;
+    result.mean_lead_us = early ? totals.mean_lead_us / early : 0;
+    return result;
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  clock::time_point origin_real;
+  std::optional<uint64_t> origin_event;
+
+  // Holds sums rather than means until stats() is called
+  std::mutex stats_lock;
+  PacingStats totals;
+
+  /// Records how late (positive) or early (negative) a batch was ready
+  void record(double lag_us) {
+    const std::lock_guard lock{stats_lock};
+    totals.batches++;
+    if (lag_us > 0) {
+      totals.late_batches++;
+      totals.mean_lag_us += lag_us;
+      totals.max_lag_us = std::max(totals.max_lag_us, lag_us);
+    } else {
+      totals.mean_lead_us -= lag_us;
+      totals.max_lead_us = std::max(totals.max_lead_us, -lag_us);
+    }
+  }
+};
+
+/**
+ * Paces a stream of events to their timestamps. Events are released in
+ * batches of up to batch_size events or batch_time of event time, so the
+ * clock is read once per batch rather than once per event. No event is
+ * released before its time.
+ */
+inline Generator<AER::Event>
+pace_events(Generator<AER::Event> &generator, Pacer &pacer,
+            const std::atomic<bool> *running = nullptr,
+            size_t batch_size = 512,
+            std::chrono::nanoseconds batch_time =
+                std::chrono::milliseconds(1)) {
+  const uint64_t batch_span = std::max<uint64_t>(1, batch_time / pacer.unit);
+  std::vector<AER::Event> batch;
+  batch.reserve(batch_size);
+  for (AER::Event event : generator) {
+    if (!batch.empty() && (batch.size() >= batch_size ||
+                           event.timestamp >= batch.front().timestamp +
+                                                  batch_span)) {
+      pacer.pace(batch.back().timestamp, running);
+      for (const auto &paced : batch) {
+        co_yield paced;
+      }
+      batch.clear();
+    }
+    batch.push_back(event);
+  }
+  if (!batch.empty()) {
+    pacer.pace(batch.back().timestamp, running);
+    for (const auto &paced : batch) {
+      co_yield paced;
+    }
+  }
+  co_return;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "aer.hpp"
+#include "generator.hpp"
+
+/**
+ * A rectangle of sensor pixels, downsampled by an integer factor. Events
+ * outside the rectangle are dropped, and the coordinates of the others are
+ * shifted to its corner and divided by the factor, so each factor x factor
+ * block of pixels pools into one.
+ */
+struct Region {
+  uint16_t x;
+  uint16_t y;
+  // Size in sensor pixels; by default the region reaches past any sensor
+  uint16_t width;
+  uint16_t height;
+  uint16_t factor;
+
+  /// @throws std::invalid_argument if the region is empty or the factor is 0
+  Region(uint16_t x = 0, uint16_t y = 0, uint16_t width = UINT16_MAX,
+         uint16_t height = UINT16_MAX, uint16_t factor = 1)
+      : x(x), y(y), width(width), height(height), factor(factor) {
+    if (width == 0 || height == 0) {
+      throw std::invalid_argument("Regions must be at least one pixel wide");
+    }
+    if (factor == 0) {
+      throw std::invalid_argument("Downsampling factors must be positive");
+    }
+  }
+
+  bool contains(uint16_t event_x, uint16_t event_y) const {
+    // Coordinates before the corner wrap around past the width and height
+    return static_cast<uint16_t>(event_x - x) < width &&
+           static_cast<uint16_t>(event_y - y) < height;
+  }
+  uint16_t scale_x(uint16_t event_x) const { return (event_x - x) / factor; }
+  uint16_t scale_y(uint16_t event_y) const { return (event_y - y) / factor; }
+
+  /// Size of the downsampled region. Partial blocks at the far edges count
+  /// as whole pixels.
+  size_t scaled_width() const { return (width + factor - 1) / factor; }
+  size_t scaled_height() const { return (height + factor - 1) / factor; }
+};
+
+/**
+ * Drops the events outside a region and moves the others into its
+ * downsampled coordinates. Events that land on the same pixel are all kept,
+ * so consumers that count them sum-pool the blocks.
+ */
+inline Generator<AER::Event> crop_events(Generator<AER::Event> &generator,
+                                         const Region region) {
+  for (AER::Event event : generator) {
+    if (!region.contains(event.x, event.y)) {
+      continue;
+    }
+    event.x = region.scale_x(event.x);
+    event.y = region.scale_y(event.y);
+    co_yield event;
+  }
+  co_return;
+}
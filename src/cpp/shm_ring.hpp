@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "aer.hpp"
+
+/**
+ * Layout of a ring of event batches in POSIX shared memory, written by one
+ * producer and read by any number of consumers in other processes.
+ *
+ * The producer never waits for consumers. It writes batch n into slot
+ * n % slots, overwriting batch n - slots, so consumers that fall a whole
+ * ring behind skip ahead and count the batches they lost. The sequence of a
+ * slot is odd while the producer writes it and 2 * (n + 1) once batch n is
+ * published, so consumers reading events in place can tell whether the
+ * batch changed under them.
+ *
+ * Consumers register in one of MAX_CONSUMERS entries, where they publish
+ * how far they read, so the producer can report how far each lags behind.
+ */
+struct ShmRingHeader {
+  static constexpr uint32_t MAGIC = 0xAE575348;
+  static constexpr uint32_t VERSION = 1;
+  static constexpr size_t MAX_CONSUMERS = 16;
+
+  struct Consumer {
+    // Process holding the entry, or 0 if free
+    std::atomic<int32_t> pid;
+    // Batches read, and batches lost by falling behind
+    std::atomic<uint64_t> cursor;
+    std::atomic<uint64_t> lost;
+  };
+
+  // Written last, once the rest of the header is in place
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t slot_events;
+  uint64_t slot_bytes;
+
+  // Batches published so far, and whether the producer is done. Consumers
+  // check that the producer process lives, in case it ended abruptly.
+  alignas(64) std::atomic<uint64_t> published;
+  std::atomic<uint32_t> closed;
+  std::atomic<int32_t> producer;
+  // Consumers sleeping on the futex word, which changes when they are woken
+  alignas(64) std::atomic<uint32_t> waiters;
+  std::atomic<uint32_t> wakeups;
+
+  alignas(64) Consumer consumers[MAX_CONSUMERS];
+
+  static size_t slot_bytes_for(uint32_t slot_events);
+  size_t total_bytes() const {
+    return sizeof(ShmRingHeader) + slots * slot_bytes;
+  }
+};
+
+/**
+ * A slot of the ring, followed by room for slot_events packed events.
+ */
+struct ShmRingSlot {
+  std::atomic<uint64_t> sequence;
+  uint32_t events;
+  uint32_t reserved;
+
+  AER::Event *data() { return reinterpret_cast<AER::Event *>(this + 1); }
+  const AER::Event *data() const {
+    return reinterpret_cast<const AER::Event *>(this + 1);
+  }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "Shared memory rings need address-free atomics");
+static_assert(sizeof(ShmRingSlot) == 16);
+
+// Slots start on cache lines, so producer and consumers of neighbouring
+// slots do not share them
+inline size_t ShmRingHeader::slot_bytes_for(uint32_t slot_events) {
+  const size_t bytes = sizeof(ShmRingSlot) + slot_events * sizeof(AER::Event);
+  return (bytes + 63) / 64 * 64;
+}
+
+inline ShmRingSlot *ring_slot(ShmRingHeader *header, uint64_t batch) {
+  auto *slots = reinterpret_cast<uint8_t *>(header) + sizeof(ShmRingHeader);
+  return reinterpret_cast<ShmRingSlot *>(slots + (batch % header->slots) *
+                                                     header->slot_bytes);
+}
+
+/// Names of POSIX shared memory objects start with a slash
+inline std::string shm_object_name(const std::string &name) {
+  return name.starts_with("/") ? name : "/" + name;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "futex.hpp"
+
+/**
+ * Bounded ring that hands items from one producer thread to one consumer
+ * thread without locks, such as from the callback of a camera driver to a
+ * generator. The producer never waits: what does not fit is dropped and
+ * counted. The consumer sleeps on a futex while the ring is empty, and the
+ * producer only wakes it while it sleeps.
+ */
+template <typename T> class SpscRing {
+public:
+  const size_t capacity;
+
+  /// Holds at least the given number of items, rounded up to a power of two
+  /// @throws std::invalid_argument if the capacity is 0
+  explicit SpscRing(size_t min_capacity)
+      : capacity(std::bit_ceil(min_capacity)), mask(capacity - 1),
+        items(std::make_unique<T[]>(capacity)) {
+    if (min_capacity == 0) {
+      throw std::invalid_argument("Rings hold at least 1 item");
+    }
+  }
+
+  /**
+   * Copies converted items into the ring in bulk, from the producer thread.
+   * Items beyond the free space are dropped.
+   *
+   * @return The number of items copied
+   */
+  template <typename Iterator, typename Convert>
+  size_t push(Iterator first, Iterator last, Convert convert) {
+    const size_t count = std::distance(first, last);
+    const uint64_t head = this->head.load(std::memory_order_relaxed);
+    if (capacity - (head - cached_tail) < count) {
+      cached_tail = tail.load(std::memory_order_acquire);
+    }
+    const size_t copied =
+        std::min<size_t>(count, capacity - (head - cached_tail));
+    for (size_t i = 0; i < copied; i++, ++first) {
+      items[(head + i) & mask] = convert(*first);
+    }
+    if (copied < count) {
+      dropped_items.fetch_add(count - copied, std::memory_order_relaxed);
+      dropped_pushes.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (copied > 0) {
+      pushed_items.fetch_add(copied, std::memory_order_relaxed);
+      publish(head + copied);
+    }
+    return copied;
+  }
+  size_t push(std::span<const T> batch) {
+    return push(batch.begin(), batch.end(), [](const T &item) { return item; });
+  }
+
+  /**
+   * Moves up to max_items into the vector, replacing its items, from the
+   * consumer thread. Waits for items while the ring is empty.
+   *
+   * @return The number of items moved, which is 0 if none arrived within the
+   * timeout or the ring is closed and empty
+   */
+  size_t pop(std::vector<T> &batch, size_t max_items,
+             std::chrono::nanoseconds timeout) {
+    batch.clear();
+    const uint64_t tail = this->tail.load(std::memory_order_relaxed);
+    if (cached_head == tail && !wait(tail, timeout)) {
+      return 0;
+    }
+    const size_t count = std::min<size_t>(max_items, cached_head - tail);
+    batch.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      batch[i] = items[(tail + i) & mask];
+    }
+    this->tail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /// Wakes the consumer, whose pops return 0 once the ring is empty
+  void close() {
+    is_closed.store(true);
+    wakeups.fetch_add(1);
+    futex_wake_all(wakeups);
+  }
+  bool closed() const { return is_closed.load(); }
+
+  uint64_t pushed() const { return pushed_items.load(); }
+  /// Items dropped because the ring was full, and the pushes that dropped any
+  uint64_t dropped() const { return dropped_items.load(); }
+  uint64_t dropped_batches() const { return dropped_pushes.load(); }
+
+private:
+  const uint64_t mask;
+  std::unique_ptr<T[]> items;
+
+  // Written by the producer, with its copy of the tail
+  alignas(64) std::atomic<uint64_t> head = 0;
+  uint64_t cached_tail = 0;
+  std::atomic<uint64_t> pushed_items = 0;
+  std::atomic<uint64_t> dropped_items = 0;
+  std::atomic<uint64_t> dropped_pushes = 0;
+  // Written by the consumer, with its copy of the head
+  alignas(64) std::atomic<uint64_t> tail = 0;
+  uint64_t cached_head = 0;
+  // Shared by both to sleep and wake
+  alignas(64) std::atomic<uint32_t> waiters = 0;
+  std::atomic<uint32_t> wakeups = 0;
+  std::atomic<bool> is_closed = false;
+
+  void publish(uint64_t new_head) {
+    head.store(new_head, std::memory_order_seq_cst);
+    // The consumer announces that it sleeps before it checks the head, so
+    // either it sees these items or we see it
+    if (waiters.load(std::memory_order_seq_cst) > 0) {
+      wakeups.fetch_add(1);
+      futex_wake_all(wakeups);
+    }
+  }
+
+  // Waits until the head moves past the tail, and whether it did
+  bool wait(uint64_t tail, std::chrono::nanoseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (cached_head != tail) {
+        return true;
+      }
+      const auto now = std::chrono::steady_clock::now();
+      if (is_closed.load() || now >= deadline) {
+        return false;
+      }
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      const uint32_t seen = wakeups.load();
+      if (head.load(std::memory_order_seq_cst) == tail && !is_closed.load()) {
+        futex_wait(wakeups, seen, deadline - now);
+      }
+      waiters.fetch_sub(1);
+    }
+  }
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aer.hpp"
+
+static_assert(sizeof(AER::Event) == 13);
+
+/**
+ * Header of a frame of events on a stream socket, over TCP or a Unix domain
+ * socket. The events follow as packed AER::Events of 13 bytes, so receivers
+ * read them into memory as they are. Fields are little endian.
+ */
+struct StreamFrameHeader {
+  static constexpr uint32_t MAGIC = 0xAE57F4A3;
+  // Bounds the memory a receiver allocates for one frame
+  static constexpr uint32_t MAX_EVENTS = 1 << 24;
+
+  uint32_t magic = MAGIC;
+  uint32_t events = 0;
+
+  bool valid() const { return magic == MAGIC && events <= MAX_EVENTS; }
+  size_t payload_bytes() const { return size_t(events) * sizeof(AER::Event); }
+};
+static_assert(sizeof(StreamFrameHeader) == 8);
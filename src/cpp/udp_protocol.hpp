@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include <lz4.h>
+
+#include "aer.hpp"
+
+/**
+ * Header of a timestamped UDP packet, followed by TimedEvents whose times
+ * are offsets from the base timestamp. Fields are little endian. Packets
+ * without the header are untimed SPIF packets, whose words may match the
+ * magic and version, but always set the high bit of x in their fourth byte.
+ * That byte lands in the flags, and flags this version does not know are
+ * rejected, so SPIF packets never parse as timed ones.
+ */
+struct TimedPacketHeader {
+  static constexpr uint16_t MAGIC = 0xAE57;
+  static constexpr uint8_t VERSION = 1;
+  // Flags of packed packets, whose events are coded as in PackedPacket
+  static constexpr uint8_t PACKED = 0x1;
+  static constexpr uint8_t LZ4 = 0x2;
+  static constexpr uint8_t KNOWN_FLAGS = PACKED | LZ4;
+
+  uint16_t magic = MAGIC;
+  uint8_t version = VERSION;
+  uint8_t flags = 0;
+  // Counts packets from zero, so receivers can tell lost and reordered ones
+  uint32_t sequence = 0;
+  uint64_t base_timestamp = 0;
+};
+static_assert(sizeof(TimedPacketHeader) == 16);
+
+struct TimedEvent {
+  // Time after the base timestamp of the packet
+  uint32_t delta_t;
+  uint16_t x;
+  // The y coordinate, with the polarity in the high bit
+  uint16_t y;
+};
+static_assert(sizeof(TimedEvent) == 8);
+
+/**
+ * The events of a timestamped packet, decoded in place from the received
+ * bytes as they are accessed.
+ */
+class TimedPacket {
+public:
+  /// Returns the packet held by a datagram, if it carries a timed header
+  static std::optional<TimedPacket> parse(const void *data, size_t bytes) {
+    const size_t header_bytes = sizeof(TimedPacketHeader);
+    if (bytes < header_bytes ||
+        (bytes - header_bytes) % sizeof(TimedEvent) != 0) {
+      return std::nullopt;
+    }
+    const auto *header = static_cast<const TimedPacketHeader *>(data);
+    // Timed packets set no flags
+    if (header->magic != TimedPacketHeader::MAGIC ||
+        header->version != TimedPacketHeader::VERSION || header->flags != 0) {
+      return std::nullopt;
+    }
+    return TimedPacket(header, (bytes - header_bytes) / sizeof(TimedEvent));
+  }
+
+  uint32_t sequence() const { return header->sequence; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  AER::Event operator[](size_t i) const {
+    const TimedEvent &event = events[i];
+    return {header->base_timestamp + event.delta_t, event.x,
+            static_cast<uint16_t>(event.y & 0x7FFF),
+            static_cast<bool>(event.y & 0x8000)};
+  }
+  AER::Event front() const { return (*this)[0]; }
+  AER::Event back() const { return (*this)[count - 1]; }
+
+private:
+  const TimedPacketHeader *header;
+  const TimedEvent *events;
+  size_t count;
+
+  TimedPacket(const TimedPacketHeader *header, size_t count)
+      : header(header), events(reinterpret_cast<const TimedEvent *>(header + 1)),
+        count(count) {}
+};
+
+/// How DVSToUDP codes events on the wire
+enum class UDPEncoding { SPIF, Timed, Packed, PackedLZ4 };
+
+/**
+ * Follows the header of a packed packet. The body holds the events sorted by
+ * row and column, and may be compressed with LZ4 as a whole.
+ */
+struct PackedPacketHeader {
+  TimedPacketHeader timed;
+  uint32_t count = 0;
+  // Size of the body before compression
+  uint32_t body_bytes = 0;
+};
+static_assert(sizeof(PackedPacketHeader) == 24);
+
+/**
+ * The events of a packed packet, coded with variable-length integers (LEB128)
+ * in a body of rows. Each row starts with its distance to the previous row
+ * and its number of events, and each event holds its distance to the
+ * previous column, shifted left to carry the polarity in the lowest bit, and
+ * its time after the base timestamp. Rows of nearby events thus cost around
+ * two bytes per event.
+ */
+class PackedPacket {
+public:
+  // Most bytes a packed event can take: up to six for the row and count when
+  // it is alone in its row, three for the column and ten for the time
+  static constexpr size_t MAX_EVENT_BYTES = 19;
+
+  static constexpr size_t max_bytes(size_t events) {
+    return sizeof(PackedPacketHeader) + events * MAX_EVENT_BYTES;
+  }
+
+  /// Returns the packet held by a datagram, if it carries a packed header
+  static std::optional<PackedPacket> parse(const void *data, size_t bytes) {
+    if (bytes < sizeof(PackedPacketHeader)) {
+      return std::nullopt;
+    }
+    const auto *header = static_cast<const PackedPacketHeader *>(data);
+    if (header->timed.magic != TimedPacketHeader::MAGIC ||
+        header->timed.version != TimedPacketHeader::VERSION ||
+        !(header->timed.flags & TimedPacketHeader::PACKED) ||
+        (header->timed.flags & ~TimedPacketHeader::KNOWN_FLAGS)) {
+      return std::nullopt;
+    }
+    return PackedPacket(header, bytes - sizeof(PackedPacketHeader));
+  }
+
+  /**
+   * Codes events into a packet at the output, which must hold max_bytes of
+   * them, and sorts the events on the way. Bodies that LZ4 cannot shrink are
+   * sent as they are.
+   *
+   * @return The size of the packet
+   */
+  static size_t encode(std::span<AER::Event> events, uint32_t sequence,
+                       bool lz4, uint8_t *output,
+                       std::vector<uint8_t> &scratch) {
+    std::sort(events.begin(), events.end(),
+              [](const AER::Event &a, const AER::Event &b) {
+                return std::tie(a.y, a.x, a.timestamp) <
+                       std::tie(b.y, b.x, b.timestamp);
+              });
+    PackedPacketHeader header;
+    header.timed.flags = TimedPacketHeader::PACKED;
+    header.timed.sequence = sequence;
+    header.count = events.size();
+    for (const auto &event : events) {
+      if (&event == events.data() ||
+          event.timestamp < header.timed.base_timestamp) {
+        header.timed.base_timestamp = event.timestamp;
+      }
+    }
+
+    scratch.resize(events.size() * MAX_EVENT_BYTES);
+    uint8_t *body = lz4 ? scratch.data() : output + sizeof(header);
+    uint8_t *end = body;
+    uint16_t row = 0;
+    for (size_t i = 0; i < events.size();) {
+      size_t row_end = i + 1;
+      while (row_end < events.size() && events[row_end].y == events[i].y) {
+        row_end++;
+      }
+      end = put_varint(end, events[i].y - row);
+      end = put_varint(end, row_end - i);
+      row = events[i].y;
+      uint16_t column = 0;
+      for (; i < row_end; i++) {
+        const AER::Event &event = events[i];
+        end = put_varint(end, (uint32_t(event.x - column) << 1) |
+                                  event.polarity);
+        end = put_varint(end, event.timestamp - header.timed.base_timestamp);
+        column = event.x;
+      }
+    }
+    header.body_bytes = end - body;
+
+    size_t packet_bytes = sizeof(header) + header.body_bytes;
+    if (lz4) {
+      // Leaves the body uncompressed unless that saves at least a byte
+      const int compressed =
+          header.body_bytes > 1
+              ? LZ4_compress_default(
+                    reinterpret_cast<const char *>(body),
+                    reinterpret_cast<char *>(output + sizeof(header)),
+                    header.body_bytes, header.body_bytes - 1)
+              : 0;
+      if (compressed > 0) {
+        header.timed.flags |= TimedPacketHeader::LZ4;
+        packet_bytes = sizeof(header) + compressed;
+      } else {
+        memcpy(output + sizeof(header), body, header.body_bytes);
+      }
+    }
+    memcpy(output, &header, sizeof(header));
+    return packet_bytes;
+  }
+
+  uint32_t sequence() const { return header->timed.sequence; }
+  size_t size() const { return header->count; }
+
+  /**
+   * Decodes the events into a vector, sorted by row and column, except that
+   * the latest event is moved to the end so it marks the time of the packet.
+   *
+   * @return False if the packet is malformed
+   */
+  bool decode(std::vector<AER::Event> &events,
+              std::vector<uint8_t> &scratch) const {
+    // Bodies fit a datagram, and each event takes at least two bytes
+    if (header->body_bytes > UINT16_MAX ||
+        header->count > header->body_bytes / 2) {
+      return false;
+    }
+    const uint8_t *body = reinterpret_cast<const uint8_t *>(header + 1);
+    if (header->timed.flags & TimedPacketHeader::LZ4) {
+      scratch.resize(header->body_bytes);
+      const int decompressed = LZ4_decompress_safe(
+          reinterpret_cast<const char *>(body),
+          reinterpret_cast<char *>(scratch.data()), bytes, header->body_bytes);
+      if (decompressed != static_cast<int>(header->body_bytes)) {
+        return false;
+      }
+      body = scratch.data();
+    } else if (bytes != header->body_bytes) {
+      return false;
+    }
+
+    const uint8_t *end = body + header->body_bytes;
+    const uint64_t base = header->timed.base_timestamp;
+    events.resize(header->count);
+    size_t latest = 0;
+    uint64_t latest_time = 0;
+    uint64_t row = 0;
+    for (size_t i = 0; i < events.size();) {
+      uint64_t row_delta, row_events;
+      body = get_varint(body, end, row_delta);
+      body = get_varint(body, end, row_events);
+      if (body == nullptr || row_delta > UINT16_MAX - row || row_events == 0 ||
+          row_events > events.size() - i) {
+        return false;
+      }
+      row += row_delta;
+      uint64_t column = 0;
+      for (const size_t row_end = i + row_events; i < row_end; i++) {
+        uint64_t column_delta, time;
+        body = get_varint(body, end, column_delta);
+        body = get_varint(body, end, time);
+        if (body == nullptr || (column_delta >> 1) > UINT16_MAX - column) {
+          return false;
+        }
+        column += column_delta >> 1;
+        events[i] = {base + time, static_cast<uint16_t>(column),
+                     static_cast<uint16_t>(row),
+                     static_cast<bool>(column_delta & 1)};
+        if (time >= latest_time) {
+          latest = i;
+          latest_time = time;
+        }
+      }
+    }
+    if (!events.empty()) {
+      std::swap(events[latest], events.back());
+    }
+    return body == end;
+  }
+
+private:
+  const PackedPacketHeader *header;
+  size_t bytes;
+
+  PackedPacket(const PackedPacketHeader *header, size_t bytes)
+      : header(header), bytes(bytes) {}
+
+  static uint8_t *put_varint(uint8_t *output, uint64_t value) {
+    while (value >= 0x80) {
+      *output++ = static_cast<uint8_t>(value) | 0x80;
+      value >>= 7;
+    }
+    *output++ = static_cast<uint8_t>(value);
+    return output;
+  }
+
+  // Returns null if the input ends inside the integer, and passes null on
+  static const uint8_t *get_varint(const uint8_t *input, const uint8_t *end,
+                                   uint64_t &value) {
+    value = 0;
+    if (input == nullptr) {
+      return nullptr;
+    }
+    for (unsigned shift = 0; input < end && shift < 64; shift += 7) {
+      const uint8_t byte = *input++;
+      value |= uint64_t(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        return input;
+      }
+    }
+    return nullptr;
+  }
+};
+
+/**
+ * Counts the packets missing from, or arriving out of order in, a stream of
+ * sequence numbers. Late packets are first counted as lost, and no longer
+ * once they arrive.
+ */
+struct SequenceTracker {
+  std::optional<uint32_t> expected;
+  uint64_t lost = 0;
+  uint64_t reordered = 0;
+
+  void receive(uint32_t sequence) {
+    if (!expected) {
+      expected = sequence + 1;
+      return;
+    }
+    // Differences wrap around with the sequence numbers
+    const int32_t gap = static_cast<int32_t>(sequence - *expected);
+    if (gap >= 0) {
+      lost += gap;
+      expected = sequence + 1;
+    } else {
+      reordered++;
+      lost -= lost > 0;
+    }
+  }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "aer.hpp"
+
+static_assert(sizeof(AER::Event) == 13);
+
+/// Event of a SynSense Speck, as its JitZMQStreamer publishes them
+struct DvsEvent {
+  bool polarity;
+  uint8_t y;
+  uint8_t x;
+  uint32_t timestamp;
+};
+
+// ZMQ messages of events come in two parts: a topic, and the events
+/// Topic of DvsEvents from SynSense Speck
+constexpr std::string_view ZMQ_DVS_TOPIC = "V";
+/// Topic of packed AER::Events of 13 bytes, as `output zmq` publishes them
+constexpr std::string_view ZMQ_EVENTS_TOPIC = "E";
+
+/// Subscription message of an XSUB socket, which subscribes to every topic
+constexpr char ZMQ_SUBSCRIBE_HEADER = 1;
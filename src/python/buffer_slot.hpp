@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+/**
+ * Lock-free handoff of the buffer a single producer accumulates into.
+ * The producer marks the buffer it writes to and never blocks. The consumer
+ * swaps in a fresh buffer atomically and waits at most for the batch the
+ * producer is writing into the old one. Together with the fresh buffer this
+ * gives a triple buffer: one being written, one being read, one spare.
+ */
+template <typename T> class BufferSlot {
+public:
+  explicit BufferSlot(T *initial = nullptr) : active(initial) {}
+
+  /// Marks and returns the current buffer for writing by the producer
+  T *begin_write() {
+    T *buffer = active.load();
+    while (true) {
+      writing.store(buffer);
+      T *current = active.load();
+      if (current == buffer) {
+        return buffer;
+      }
+      buffer = current;
+    }
+  }
+
+  /// Marks the end of the producer's write
+  void end_write() { writing.store(nullptr, std::memory_order_release); }
+
+  /// Swaps in a fresh buffer and returns the old one once it is not written
+  T *exchange(T *fresh) {
+    T *old = active.exchange(fresh);
+    // Like begin_write, store then load with seq_cst: weaker orders let both
+    // sides miss each other, and the producer keep writing into old
+    while (old && writing.load() == old) {
+      std::this_thread::yield();
+    }
+    return old;
+  }
+
+  T *get() const { return active.load(); }
+
+private:
+  std::atomic<T *> active;
+  std::atomic<T *> writing = nullptr;
+};
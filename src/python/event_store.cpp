@@ -0,0 +1,141 @@
+#include <utility>
+
+#include "event_store.hpp"
+
+template <typename T>
+using column_t = nb::ndarray<nb::numpy, T, nb::shape<-1>>;
+using indices_t = nb::ndarray<nb::numpy, uint16_t, nb::shape<2, -1>>;
+
+EventStore::EventStore() { batch_slot.exchange(acquire()); }
+
+void EventStore::append(std::span<const AER::Event> events) {
+  EventBatch *batch = batch_slot.begin_write();
+  for (const auto &event : events) {
+    batch->append(event.timestamp, event.x, event.y, event.polarity);
+  }
+  batch_slot.end_write();
+}
+
+void EventStore::append_packet(const uint16_t *data, int length,
+                               uint64_t timestamp) {
+  EventBatch *batch = batch_slot.begin_write();
+  for (int i = 0; i < length; i = i + 2) {
+    // Decode x, y and the polarity stored in the high bit of y
+    batch->append(timestamp, data[i + 1] & 0x7FFF, data[i] & 0x7FFF,
+                  data[i] & 0x8000);
+  }
+  batch_slot.end_write();
+}
+
+void EventStore::append(const TimedPacket &packet) {
+  EventBatch *batch = batch_slot.begin_write();
+  for (size_t i = 0; i < packet.size(); i++) {
+    const AER::Event event = packet[i];
+    batch->append(event.timestamp, event.x, event.y, event.polarity);
+  }
+  batch_slot.end_write();
+}
+
+EventBatch *EventStore::swap() {
+  const std::lock_guard lock{read_lock};
+  EventBatch *batch = batch_slot.exchange(acquire());
+  batch->store = shared_from_this();
+  return batch;
+}
+
+// Takes the batches of all stores, and appends the events of the others to
+// the batch of the first
+EventBatch *EventStore::swap_all(const std::vector<EventStore *> &stores) {
+  EventBatch *batch = stores[0]->swap();
+  for (size_t i = 1; i < stores.size(); i++) {
+    EventBatch *other = stores[i]->swap();
+    batch->timestamps.insert(batch->timestamps.end(), other->timestamps.begin(),
+                             other->timestamps.end());
+    batch->coordinates.insert(batch->coordinates.end(),
+                              other->coordinates.begin(),
+                              other->coordinates.end());
+    batch->polarities.insert(batch->polarities.end(),
+                             other->polarities.begin(),
+                             other->polarities.end());
+    other->release();
+  }
+  return batch;
+}
+
+nb::dict EventStore::read_events() { return to_events(swap()); }
+
+nb::dict EventStore::read_events(const std::vector<EventStore *> &stores) {
+  return to_events(swap_all(stores));
+}
+
+nb::tuple EventStore::read_sparse() { return to_sparse(swap()); }
+
+nb::tuple EventStore::read_sparse(const std::vector<EventStore *> &stores) {
+  return to_sparse(swap_all(stores));
+}
+
+nb::dict EventStore::to_events(EventBatch *batch) {
+  // The columns share one owner, which returns the batch once all are freed
+  nb::capsule owner(batch, [](void *p) noexcept {
+    static_cast<EventBatch *>(p)->release();
+  });
+  const size_t shape[1] = {batch->size()};
+  const int64_t coordinate_strides[1] = {2};
+  nb::dict events;
+  events["timestamp"] = nb::cast(
+      column_t<uint64_t>(batch->timestamps.data(), 1, shape, owner));
+  events["x"] = nb::cast(column_t<uint16_t>(batch->coordinates.data(), 1,
+                                            shape, owner, coordinate_strides));
+  events["y"] =
+      nb::cast(column_t<uint16_t>(batch->coordinates.data() + 1, 1, shape,
+                                  owner, coordinate_strides));
+  events["polarity"] = nb::cast(column_t<bool>(
+      reinterpret_cast<bool *>(batch->polarities.data()), 1, shape, owner));
+  return events;
+}
+
+nb::tuple EventStore::to_sparse(EventBatch *batch) {
+  nb::capsule owner(batch, [](void *p) noexcept {
+    static_cast<EventBatch *>(p)->release();
+  });
+  const size_t indices_shape[2] = {2, batch->size()};
+  const int64_t indices_strides[2] = {1, 2};
+  const size_t values_shape[1] = {batch->size()};
+  return nb::make_tuple(
+      indices_t(batch->coordinates.data(), 2, indices_shape, owner,
+                indices_strides),
+      column_t<bool>(reinterpret_cast<bool *>(batch->polarities.data()), 1,
+                     values_shape, owner));
+}
+
+EventBatch *EventStore::acquire() {
+  const std::lock_guard lock{pool_lock};
+  if (free_batches.empty()) {
+    batches.push_back(std::make_unique<EventBatch>());
+    EventBatch *batch = batches.back().get();
+    // Reserve up front, so empty columns still point to valid memory
+    batch->timestamps.reserve(INITIAL_CAPACITY);
+    batch->coordinates.reserve(2 * INITIAL_CAPACITY);
+    batch->polarities.reserve(INITIAL_CAPACITY);
+    return batch;
+  }
+  EventBatch *batch = free_batches.back();
+  free_batches.pop_back();
+  return batch;
+}
+
+void EventStore::recycle(EventBatch *batch) {
+  // Clearing keeps the capacity the batch has grown to
+  batch->timestamps.clear();
+  batch->coordinates.clear();
+  batch->polarities.clear();
+  const std::lock_guard lock{pool_lock};
+  free_batches.push_back(batch);
+}
+
+void EventBatch::release() noexcept {
+  // Keep the store alive until the batch is back, even if this was the last
+  // reference to it
+  const auto owner = std::move(store);
+  owner->recycle(this);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "../cpp/aer.hpp"
+#include "../cpp/udp_protocol.hpp"
+#include "buffer_slot.hpp"
+#include "types.hpp"
+
+class EventStore;
+
+/**
+ * Events collected between two reads, stored in columns. The x and y
+ * columns are interleaved so that the coordinates double as COO indices.
+ */
+struct EventBatch {
+  std::vector<uint64_t> timestamps;
+  std::vector<uint16_t> coordinates;
+  std::vector<uint8_t> polarities;
+  // Set while the batch is lent out to Python
+  std::shared_ptr<EventStore> store;
+
+  size_t size() const { return timestamps.size(); }
+
+  void append(uint64_t timestamp, uint16_t x, uint16_t y, bool polarity) {
+    timestamps.push_back(timestamp);
+    coordinates.push_back(x);
+    coordinates.push_back(y);
+    polarities.push_back(polarity);
+  }
+
+  /// Returns the batch to its store
+  void release() noexcept;
+};
+
+/**
+ * Records the events an input receives, so they can be read as they are
+ * rather than accumulated into frames. The producer appends to one batch
+ * while the previous one is read, and batches keep their capacity when
+ * they return to the store after Python frees their arrays.
+ */
+class EventStore : public std::enable_shared_from_this<EventStore> {
+public:
+  EventStore();
+
+  void append(std::span<const AER::Event> events);
+  /// Appends the events of a UDP packet, which all share one timestamp
+  void append_packet(const uint16_t *data, int length, uint64_t timestamp);
+  void append(const TimedPacket &packet);
+
+  /// Returns the events since the last read as columns, without copying them
+  nb::dict read_events();
+  /// Returns the events since the last read as (2, N) COO indices of their
+  /// x and y coordinates, with their polarities as values
+  nb::tuple read_sparse();
+  /// Like read_events and read_sparse, for stores that record the shards of
+  /// one input, with the events of one store after those of the previous
+  static nb::dict read_events(const std::vector<EventStore *> &stores);
+  static nb::tuple read_sparse(const std::vector<EventStore *> &stores);
+
+private:
+  friend struct EventBatch;
+  static const size_t INITIAL_CAPACITY = 4096;
+
+  // Serializes readers; never taken by the producer
+  std::mutex read_lock;
+  std::mutex pool_lock;
+  std::vector<std::unique_ptr<EventBatch>> batches;
+  std::vector<EventBatch *> free_batches;
+  BufferSlot<EventBatch> batch_slot;
+
+  EventBatch *acquire();
+  EventBatch *swap();
+  static EventBatch *swap_all(const std::vector<EventStore *> &stores);
+  static nb::dict to_events(EventBatch *batch);
+  static nb::tuple to_sparse(EventBatch *batch);
+  void recycle(EventBatch *batch);
+};
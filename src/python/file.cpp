@@ -8,31 +8,56 @@ void FileInput::stream_generator_to_buffer() {
     if (!is_streaming.load()) {
       break;
     }
+    // Paced batches also end after a short span of event time, so sparse
+    // recordings are not held back until the batch fills
+    if (pacer && !local_buffer.empty() &&
+        event.timestamp >=
+            local_buffer.front().timestamp + PACING_INTERVAL_US) {
+      flush(local_buffer);
+    }
     local_buffer.push_back(event);
 
     if (local_buffer.size() >= EVENT_BUFFER_SIZE) {
-      buffer.set_vector(local_buffer);
-      is_nonempty.store(true);
-      local_buffer.clear();
+      flush(local_buffer);
     }
   }
   if (local_buffer.size() > 0) {
-    buffer.set_vector(local_buffer);
+    flush(local_buffer);
   }
   is_streaming.store(false);
+  buffer->finish();
+}
+
+void FileInput::flush(std::vector<AER::Event> &events) {
+  if (pacer) {
+    pacer->pace(events.back().timestamp, &is_streaming);
+  }
+  buffer->set_vector(events);
+  is_nonempty.store(true);
+  events.clear();
 }
 
 FileInput::FileInput(const std::string &filename, py_size_t shape,
-                     const std::string &device, bool ignore_time)
-    : buffer(shape, device, EVENT_BUFFER_SIZE), ignore_time(ignore_time),
-      shape(shape), filename(filename), file(open_event_file(filename)){};
+                     const std::string &device, bool ignore_time,
+                     double speed, const FrameOptions &options)
+    : buffer(make_tensor_buffer(shape, device, EVENT_BUFFER_SIZE, options)),
+      ignore_time(ignore_time),
+      pacer(ignore_time ? nullptr : std::make_unique<Pacer>(speed)),
+      shape(shape), device(device), filename(filename),
+      file(open_event_file(filename)){};
 
 std::unique_ptr<BufferPointer> FileInput::read() {
-  auto tmp = buffer.read();
+  auto tmp = buffer->read();
   is_nonempty.store(false);
   return std::unique_ptr<BufferPointer>(std::move(tmp));
 }
 
+bool FileInput::wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+                     std::optional<double> timeout) {
+  nb::gil_scoped_release release;
+  return buffer->wait(min_events, until_timestamp, timeout);
+}
+
 Generator<AER::Event>::Iter FileInput::begin() { return generator.begin(); }
 std::default_sentinel_t FileInput::end() { return generator.end(); }
 
@@ -40,17 +65,46 @@ bool FileInput::get_is_streaming() {
   return is_streaming.load() || is_nonempty.load();
 }
 
+PacingStats FileInput::pacing_stats() {
+  return pacer ? pacer->stats() : PacingStats();
+}
+
 nb::ndarray<nb::numpy, uint8_t, nb::shape<1, -1>> FileInput::load() {
-  struct Container {
-    std::vector<AER::Event> events;
-  };
-  auto [arr, n_read] = file->read_events(-1);
-  Container *c = new Container();
-  c->events = std::move(arr);
-  nb::capsule deleter(c, [](void *p) noexcept { delete (Container *)p; });
+  // Decode straight into the array memory handed to Python
+  const size_t capacity = file->count_remaining_events();
+  auto events = std::make_unique_for_overwrite<AER::Event[]>(capacity);
+  const size_t n_read = file->read_into(std::span(events.get(), capacity));
+  AER::Event *ptr = events.release();
+  nb::capsule deleter(ptr,
+                      [](void *p) noexcept { delete[] (AER::Event *)p; });
   const size_t shape[1] = {n_read * sizeof(AER::Event)};
-  return nb::ndarray<nb::numpy, uint8_t, nb::shape<1, -1>>(
-      c->events.data(), 1, shape, deleter);
+  return nb::ndarray<nb::numpy, uint8_t, nb::shape<1, -1>>(ptr, 1, shape,
+                                                           deleter);
+}
+
+size_t FileInput::read_into(
+    nb::ndarray<uint8_t, nb::shape<-1>, nb::c_contig, nb::device::cpu> out) {
+  auto events = std::span(reinterpret_cast<AER::Event *>(out.data()),
+                          out.size() / sizeof(AER::Event));
+  nb::gil_scoped_release release;
+  return file->read_into(events);
+}
+
+size_t FileInput::read_columns_into(
+    nb::ndarray<uint64_t, nb::shape<-1>, nb::c_contig, nb::device::cpu>
+        timestamp,
+    nb::ndarray<uint16_t, nb::shape<-1>, nb::c_contig, nb::device::cpu> x,
+    nb::ndarray<uint16_t, nb::shape<-1>, nb::c_contig, nb::device::cpu> y,
+    nb::ndarray<bool, nb::shape<-1>, nb::c_contig, nb::device::cpu>
+        polarity) {
+  const EventColumns columns = {
+      std::span(timestamp.data(), timestamp.size()),
+      std::span(x.data(), x.size()),
+      std::span(y.data(), y.size()),
+      std::span(polarity.data(), polarity.size()),
+  };
+  nb::gil_scoped_release release;
+  return file->read_into(columns);
 }
 
 // py::array_t<AER::Event> FileInput::events_co() {
@@ -94,6 +148,26 @@ nb::ndarray<nb::numpy, uint8_t, nb::shape<1, -1>> FileInput::load() {
 //   // }
 // }
 
+std::unique_ptr<FrameIterator>
+FileInput::frames(uint64_t window_us, std::optional<uint64_t> stride_us,
+                  size_t prefetch) {
+  // Iterators read their own copy of the file, apart from the stream, load
+  // and each other
+  return std::make_unique<FrameIterator>(open_event_file(filename), shape,
+                                         device, buffer->options, window_us,
+                                         stride_us, prefetch);
+}
+
+std::unique_ptr<BatchIterator>
+FileInput::batches(uint64_t window_us, std::optional<uint64_t> stride_us,
+                   size_t batch_size) {
+  // Iterators read their own copy of the file, apart from the stream, load
+  // and each other
+  return std::make_unique<BatchIterator>(open_event_file(filename), shape,
+                                         device, buffer->options, window_us,
+                                         stride_us, batch_size);
+}
+
 FileInput *FileInput::start_stream() {
   generator = file->stream();
   file_thread = std::unique_ptr<std::thread>(
@@ -103,7 +177,8 @@ FileInput *FileInput::start_stream() {
 
 bool FileInput::stop_stream(nb::object &a, nb::object &b, nb::object &c) {
   is_streaming.store(false);
-  if (file_thread->joinable()) {
+  if (file_thread && file_thread->joinable()) {
+    nb::gil_scoped_release release;
     file_thread->join();
   }
   return false;
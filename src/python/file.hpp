@@ -3,8 +3,10 @@
 #include "../cpp/aer.hpp"
 #include "../cpp/generator.hpp"
 #include "../cpp/input/file.hpp"
+#include "../cpp/pacer.hpp"
 #include "types.hpp"
 
+#include "frame_iterator.hpp"
 #include "tensor_buffer.hpp"
 #include "tensor_iterator.hpp"
 
@@ -12,8 +14,12 @@ class FileInput {
 
 private:
   static const uint32_t EVENT_BUFFER_SIZE = 512;
+  // Event time after which a paced batch is released, even if not full
+  static const uint64_t PACING_INTERVAL_US = 1000;
 
   const bool ignore_time;
+  // Paces the stream to the event timestamps unless time is ignored
+  std::unique_ptr<Pacer> pacer;
 
   std::unique_ptr<std::thread> file_thread;
   std::vector<AER::Event> event_vector;
@@ -24,25 +30,54 @@ private:
   void stream_file_to_buffer();
 
   void stream_generator_to_buffer();
+  void flush(std::vector<AER::Event> &events);
 
 public:
-  TensorBuffer buffer;
+  std::unique_ptr<TensorBufferBase> buffer;
   py_size_t shape;
+  const std::string device;
   const std::unique_ptr<FileBase> file;
   Generator<AER::Event> generator;
   const std::string filename;
 
   FileInput(const std::string &filename, py_size_t shape,
-            const std::string &device, bool ignore_time = false);
+            const std::string &device, bool ignore_time = false,
+            double speed = 1, const FrameOptions &options = FrameOptions());
 
   std::unique_ptr<BufferPointer> read();
-  void read_genn(uint32_t *bitmask, size_t size){ buffer.read_genn(bitmask, size); }
+  void read_genn(uint32_t *bitmask, size_t size){ buffer->read_genn(bitmask, size); }
+  nb::dict read_events() { return buffer->read_events(); }
+  nb::tuple read_sparse() { return buffer->read_sparse(); }
+  bool wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+            std::optional<double> timeout);
   Generator<AER::Event>::Iter begin();
   std::default_sentinel_t end();
 
   bool get_is_streaming();
+  /// Statistics of the real-time playback since the stream started
+  PacingStats pacing_stats();
 
   nb::ndarray<nb::numpy, uint8_t, nb::shape<1, -1>> load();
+  size_t read_into(
+      nb::ndarray<uint8_t, nb::shape<-1>, nb::c_contig, nb::device::cpu> out);
+  size_t read_columns_into(
+      nb::ndarray<uint64_t, nb::shape<-1>, nb::c_contig, nb::device::cpu>
+          timestamp,
+      nb::ndarray<uint16_t, nb::shape<-1>, nb::c_contig, nb::device::cpu> x,
+      nb::ndarray<uint16_t, nb::shape<-1>, nb::c_contig, nb::device::cpu> y,
+      nb::ndarray<bool, nb::shape<-1>, nb::c_contig, nb::device::cpu>
+          polarity);
+
+  /// Iterates over frames of window_us microseconds of event time, starting
+  /// every stride_us microseconds
+  std::unique_ptr<FrameIterator> frames(uint64_t window_us,
+                                        std::optional<uint64_t> stride_us,
+                                        size_t prefetch);
+
+  /// Iterates over batches of batch_size frames in one array each
+  std::unique_ptr<BatchIterator> batches(uint64_t window_us,
+                                         std::optional<uint64_t> stride_us,
+                                         size_t batch_size);
 
   FileInput *start_stream();
 
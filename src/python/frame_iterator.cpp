@@ -0,0 +1,305 @@
+#include "frame_iterator.hpp"
+
+EventWindows::EventWindows(uint64_t window_us, uint64_t stride_us)
+    : window_us(window_us), stride_us(stride_us) {
+  if (window_us == 0 || stride_us == 0) {
+    throw std::invalid_argument("Frame windows and strides must be positive");
+  }
+}
+
+uint64_t EventWindows::relative(uint64_t timestamp) {
+  if (!origin) {
+    origin = timestamp;
+  }
+  return timestamp > *origin ? timestamp - *origin : 0;
+}
+
+size_t EventWindows::first(uint64_t time) const {
+  return time < window_us ? 0 : (time - window_us) / stride_us + 1;
+}
+
+FrameIterator::FrameIterator(std::unique_ptr<FileBase> file,
+                             const std::vector<size_t> &shape,
+                             const std::string &device,
+                             const FrameOptions &options, uint64_t window_us,
+                             std::optional<uint64_t> stride_us,
+                             size_t prefetch)
+    : file(std::move(file)), windows(window_us, stride_us.value_or(window_us)),
+      prefetch(std::max<size_t>(prefetch, 1)),
+      is_surface(options.mode == FrameMode::Surface) {
+  if (device == "genn") {
+    throw std::invalid_argument("Frames cannot be iterated with GeNN");
+  }
+  // Voxel grids span the iterated windows
+  FrameOptions window_options = options;
+  window_options.window_us = window_us;
+  // Time surfaces carry over from frame to frame, so one buffer sees every
+  // event; other modes need one buffer per overlapping window
+  const size_t size = is_surface ? 1 : windows.overlap();
+  for (size_t i = 0; i < size; i++) {
+    buffers.push_back(make_tensor_buffer(shape, device, EVENT_BUFFER_SIZE,
+                                         window_options));
+  }
+  pending.resize(size);
+  thread = std::thread(&FrameIterator::produce, this);
+}
+
+FrameIterator::~FrameIterator() {
+  {
+    const std::lock_guard lock{frames_lock};
+    is_stopped = true;
+  }
+  frames_changed.notify_all();
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+std::unique_ptr<BufferPointer> FrameIterator::next() {
+  std::unique_ptr<BufferPointer> frame;
+  {
+    // Release the GIL before locking, so other readers cannot deadlock us
+    nb::gil_scoped_release release;
+    std::unique_lock lock{frames_lock};
+    frames_changed.wait(lock, [&] { return !frames.empty() || is_done; });
+    if (!frames.empty()) {
+      frame = std::move(frames.front());
+      frames.pop_front();
+    }
+  }
+  frames_changed.notify_all();
+  if (!frame) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    throw nb::stop_iteration();
+  }
+  return frame;
+}
+
+void FrameIterator::produce() {
+  std::vector<AER::Event> events(EVENT_BUFFER_SIZE);
+  // The oldest window that has not been emitted yet
+  size_t next_window = 0;
+  std::optional<uint64_t> last_time;
+  try {
+    while (true) {
+      const size_t size = file->read_into(std::span(events));
+      for (size_t i = 0; i < size; i++) {
+        const uint64_t time = windows.relative(events[i].timestamp);
+        // Events past the end of a window close it
+        while (time >= windows.end(next_window)) {
+          if (!emit(next_window++)) {
+            return;
+          }
+        }
+        add_event(events[i], time, next_window);
+        last_time = std::max(last_time.value_or(0), time);
+      }
+      if (size < events.size()) {
+        break;
+      }
+    }
+    // Emit the windows the last event falls into
+    if (last_time) {
+      const size_t last_window = windows.last(*last_time);
+      while (next_window <= last_window) {
+        if (!emit(next_window++)) {
+          return;
+        }
+      }
+    }
+  } catch (...) {
+    const std::lock_guard lock{frames_lock};
+    error = std::current_exception();
+  }
+  {
+    const std::lock_guard lock{frames_lock};
+    is_done = true;
+  }
+  frames_changed.notify_all();
+}
+
+void FrameIterator::add_event(const AER::Event &event, uint64_t time,
+                              size_t next_window) {
+  if (is_surface) {
+    pending[0].push_back(event);
+    if (pending[0].size() >= EVENT_BUFFER_SIZE) {
+      flush(next_window);
+    }
+    return;
+  }
+  const size_t first = std::max(windows.first(time), next_window);
+  for (size_t window = first; window <= windows.last(time); window++) {
+    auto &events = pending[window % pending.size()];
+    events.push_back(event);
+    if (events.size() >= EVENT_BUFFER_SIZE) {
+      flush(window);
+    }
+  }
+}
+
+void FrameIterator::flush(size_t window) {
+  const size_t index = window % pending.size();
+  auto &events = pending[index];
+  if (events.empty()) {
+    return;
+  }
+  buffers[index]->start_window(*windows.origin + windows.start(window));
+  buffers[index]->set_vector(events);
+  events.clear();
+}
+
+bool FrameIterator::emit(size_t window) {
+  flush(window);
+  auto frame = buffers[window % buffers.size()]->read();
+  std::unique_lock lock{frames_lock};
+  frames_changed.wait(
+      lock, [&] { return frames.size() < prefetch || is_stopped; });
+  if (is_stopped) {
+    return false;
+  }
+  frames.push_back(std::move(frame));
+  lock.unlock();
+  frames_changed.notify_all();
+  return true;
+}
+
+BatchIterator::BatchIterator(std::unique_ptr<FileBase> file,
+                             const std::vector<size_t> &shape,
+                             const std::string &device,
+                             const FrameOptions &options, uint64_t window_us,
+                             std::optional<uint64_t> stride_us,
+                             size_t batch_size)
+    : file(std::move(file)), device(device),
+      windows(window_us, stride_us.value_or(window_us)),
+      batch_size(batch_size) {
+  if (batch_size == 0) {
+    throw std::invalid_argument("Batches must hold at least one frame");
+  }
+  if (device == "genn") {
+    throw std::invalid_argument("Frames cannot be batched with GeNN");
+  }
+  FrameOptions window_options = options;
+  window_options.window_us = window_us;
+  // Time surfaces carry over from frame to frame and cannot be computed in
+  // parallel
+  const size_t max_threads =
+      std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t n_workers = options.mode == FrameMode::Surface
+                               ? 1
+                               : std::min(max_threads, batch_size);
+  for (size_t i = 0; i < n_workers; i++) {
+    workers.push_back(make_tensor_buffer(shape, device, EVENT_BUFFER_SIZE,
+                                         window_options));
+  }
+  const auto &frame_shape = workers[0]->frame_shape;
+  batch_shape.push_back(batch_size);
+  batch_shape.insert(batch_shape.end(), frame_shape.begin(),
+                     frame_shape.end());
+  last_shape = batch_shape;
+  pool = std::make_shared<BufferPool>(batch_size * workers[0]->frame_bytes(),
+                                      device);
+}
+
+std::unique_ptr<BufferPointer> BatchIterator::next() {
+  PooledBuffer *batch = nullptr;
+  size_t size = 0;
+  {
+    nb::gil_scoped_release release;
+    size = collect();
+    if (size > 0) {
+      batch = pool->acquire();
+      const size_t frame_bytes = workers[0]->frame_bytes();
+      // Worker i accumulates windows i, i + n_threads, ... of the batch
+      auto accumulate = [&](size_t worker) {
+        for (size_t i = worker; i < size; i += workers.size()) {
+          workers[worker]->accumulate(
+              static_cast<uint8_t *>(batch->data) + i * frame_bytes, open[i],
+              *windows.origin + windows.start(next_window + i));
+        }
+      };
+      std::vector<std::thread> threads;
+      for (size_t i = 1; i < std::min(workers.size(), size); i++) {
+        threads.emplace_back(accumulate, i);
+      }
+      accumulate(0);
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      // Keep the capacity of the emptied windows for later ones
+      for (size_t i = 0; i < size; i++) {
+        open[i].clear();
+        spare.push_back(std::move(open[i]));
+      }
+      open.erase(open.begin(), open.begin() + size);
+      next_window += size;
+    }
+  }
+  if (size == 0) {
+    throw nb::stop_iteration();
+  }
+  if (size < batch_size) {
+    last_shape[0] = size;
+    return std::make_unique<BufferPointer>(batch, last_shape, device,
+                                           workers[0]->frame_dtype());
+  }
+  return std::make_unique<BufferPointer>(batch, batch_shape, device,
+                                         workers[0]->frame_dtype());
+}
+
+size_t BatchIterator::collect() {
+  // Assign events until one closes the last window of the batch
+  const size_t last_window = next_window + batch_size - 1;
+  while (const AER::Event *event = peek()) {
+    const uint64_t time = windows.relative(event->timestamp);
+    if (time >= windows.end(last_window)) {
+      grow(batch_size);
+      return batch_size;
+    }
+    add_event(*event, time);
+    last_time = std::max(last_time.value_or(0), time);
+    position++;
+  }
+  // At the end of the file, the batch ends with the last event's window
+  if (!last_time || windows.last(*last_time) < next_window) {
+    return 0;
+  }
+  const size_t size =
+      std::min(windows.last(*last_time) - next_window + 1, batch_size);
+  grow(size);
+  return size;
+}
+
+const AER::Event *BatchIterator::peek() {
+  if (position == events.size() && !is_done) {
+    events.resize(EVENT_BUFFER_SIZE);
+    events.resize(file->read_into(std::span(events)));
+    is_done = events.size() < EVENT_BUFFER_SIZE;
+    position = 0;
+  }
+  return position < events.size() ? &events[position] : nullptr;
+}
+
+void BatchIterator::add_event(const AER::Event &event, uint64_t time) {
+  const size_t first = std::max(windows.first(time), next_window);
+  const size_t last = windows.last(time);
+  if (first > last) {
+    return;
+  }
+  grow(last - next_window + 1);
+  for (size_t window = first; window <= last; window++) {
+    open[window - next_window].push_back(event);
+  }
+}
+
+void BatchIterator::grow(size_t size) {
+  while (open.size() < size) {
+    if (spare.empty()) {
+      open.emplace_back();
+    } else {
+      open.push_back(std::move(spare.back()));
+      spare.pop_back();
+    }
+  }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "../cpp/aer.hpp"
+#include "../cpp/file/utils.hpp"
+#include "tensor_buffer.hpp"
+#include "types.hpp"
+
+/**
+ * Windows of window_us microseconds of event time that start every stride_us
+ * microseconds, counted from the first event. Windows overlap when the stride
+ * is shorter than the window.
+ */
+struct EventWindows {
+  const uint64_t window_us;
+  const uint64_t stride_us;
+  // Time of the first event, where the first window starts
+  std::optional<uint64_t> origin;
+
+  EventWindows(uint64_t window_us, uint64_t stride_us);
+
+  /// Time of an event relative to the first one. Events older than the
+  /// first event count as part of the first window.
+  uint64_t relative(uint64_t timestamp);
+  /// Start and end of a window, relative to the first event
+  uint64_t start(size_t window) const { return window * stride_us; }
+  uint64_t end(size_t window) const { return start(window) + window_us; }
+  /// First and last window containing a relative time
+  size_t first(uint64_t time) const;
+  size_t last(uint64_t time) const { return time / stride_us; }
+  /// Number of windows that can contain the same event
+  size_t overlap() const { return (window_us + stride_us - 1) / stride_us; }
+};
+
+/**
+ * Iterates over the frames of a file cut by event time, so a file always
+ * produces the same frames regardless of how fast it is read. A background
+ * thread decodes and accumulates up to prefetch frames ahead of the reader.
+ */
+class FrameIterator {
+public:
+  FrameIterator(std::unique_ptr<FileBase> file, const std::vector<size_t> &shape,
+                const std::string &device, const FrameOptions &options,
+                uint64_t window_us, std::optional<uint64_t> stride_us,
+                size_t prefetch);
+  ~FrameIterator();
+
+  /// Returns the next frame, or throws stop_iteration after the last one
+  std::unique_ptr<BufferPointer> next();
+
+private:
+  static const size_t EVENT_BUFFER_SIZE = 4096;
+
+  const std::unique_ptr<FileBase> file;
+  EventWindows windows;
+  const size_t prefetch;
+  const bool is_surface;
+
+  // Buffers accumulating the open windows, window k in buffer k % size
+  std::vector<std::unique_ptr<TensorBufferBase>> buffers;
+  std::vector<std::vector<AER::Event>> pending;
+
+  std::mutex frames_lock;
+  std::condition_variable frames_changed;
+  std::deque<std::unique_ptr<BufferPointer>> frames;
+  bool is_done = false;
+  bool is_stopped = false;
+  std::exception_ptr error;
+  std::thread thread;
+
+  void produce();
+  void add_event(const AER::Event &event, uint64_t time, size_t next_window);
+  void flush(size_t window);
+  /// Queues a finished window, returning false if the iterator was stopped
+  bool emit(size_t window);
+};
+
+/**
+ * Iterates over batches of frames of a file cut by event time, each filled
+ * into one (batch, ...) array. The windows of a batch are accumulated in
+ * parallel, one accumulating buffer per thread.
+ */
+class BatchIterator {
+public:
+  BatchIterator(std::unique_ptr<FileBase> file, const std::vector<size_t> &shape,
+                const std::string &device, const FrameOptions &options,
+                uint64_t window_us, std::optional<uint64_t> stride_us,
+                size_t batch_size);
+
+  /// Returns the next batch, which holds fewer frames only at the end of the
+  /// file, or throws stop_iteration after the last one
+  std::unique_ptr<BufferPointer> next();
+
+private:
+  static const size_t EVENT_BUFFER_SIZE = 4096;
+
+  const std::unique_ptr<FileBase> file;
+  const std::string device;
+  EventWindows windows;
+  const size_t batch_size;
+
+  std::vector<std::unique_ptr<TensorBufferBase>> workers;
+  std::shared_ptr<BufferPool> pool;
+  // Shapes of full batches and the last, partial one
+  std::vector<size_t> batch_shape;
+  std::vector<size_t> last_shape;
+
+  // Decoded events not yet assigned to windows
+  std::vector<AER::Event> events;
+  size_t position = 0;
+  bool is_done = false;
+  std::optional<uint64_t> last_time;
+  // Events of the open windows, starting from next_window
+  std::deque<std::vector<AER::Event>> open;
+  std::vector<std::vector<AER::Event>> spare;
+  size_t next_window = 0;
+
+  /// Fills the windows of the next batch, returning how many there are
+  size_t collect();
+  const AER::Event *peek();
+  void add_event(const AER::Event &event, uint64_t time);
+  /// Opens windows until there are size of them
+  void grow(size_t size);
+};
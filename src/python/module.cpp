@@ -1,6 +1,7 @@
 
 #include <nanobind/make_iterator.h>
 #include <nanobind/nanobind.h>
+#include <nanobind/stl/optional.h>
 #include <nanobind/stl/string.h>
 
 #include "../cpp/aer.hpp"
@@ -8,6 +9,8 @@
 #include "file.hpp"
 // #include "iterator.cpp"
 #include "types.hpp"
+#include "shm.cpp"
+#include "tcp.cpp"
 #include "udp.cpp"
 
 #if defined(WITH_CAER) || defined(WITH_METAVISION)
@@ -30,7 +33,7 @@ NB_MODULE(aestream_ext, m) {
 #ifdef WITH_METAVISION
       "metavision",
 #endif
-#ifdef with_ZMQ
+#ifdef WITH_ZMQ
       "zmq"
 #endif
   });
@@ -50,6 +53,57 @@ NB_MODULE(aestream_ext, m) {
       .value("Inivation", Camera::Inivation)
       .value("Prophesee", Camera::Prophesee);
 
+  nb::enum_<FrameMode>(m, "FrameMode")
+      .value("Count", FrameMode::Count)
+      .value("Polarity", FrameMode::Polarity)
+      .value("Signed", FrameMode::Signed)
+      .value("Binary", FrameMode::Binary)
+      .value("Voxel", FrameMode::Voxel)
+      .value("Surface", FrameMode::Surface);
+
+  nb::enum_<DType>(m, "DType")
+      .value("Float32", DType::Float32)
+      .value("UInt8", DType::UInt8)
+      .value("UInt16", DType::UInt16)
+      .value("Int16", DType::Int16)
+      .value("Bool", DType::Bool);
+
+  nb::enum_<Layout>(m, "Layout")
+      .value("WH", Layout::WH)
+      .value("HW", Layout::HW);
+
+  nb::enum_<Pooling>(m, "Pooling")
+      .value("Sum", Pooling::Sum)
+      .value("Any", Pooling::Any);
+
+  nb::class_<FrameOptions>(m, "FrameOptions")
+      .def(nb::init<>())
+      .def_rw("mode", &FrameOptions::mode)
+      .def_rw("dtype", &FrameOptions::dtype)
+      .def_rw("bins", &FrameOptions::bins)
+      .def_rw("window_us", &FrameOptions::window_us)
+      .def_rw("tau_us", &FrameOptions::tau_us)
+      .def_rw("record_events", &FrameOptions::record_events)
+      .def_rw("layout", &FrameOptions::layout)
+      .def_rw("channels_last", &FrameOptions::channels_last)
+      .def_rw("flip_x", &FrameOptions::flip_x)
+      .def_rw("flip_y", &FrameOptions::flip_y)
+      .def_rw("rotation", &FrameOptions::rotation)
+      .def_rw("roi_x", &FrameOptions::roi_x)
+      .def_rw("roi_y", &FrameOptions::roi_y)
+      .def_rw("roi_width", &FrameOptions::roi_width)
+      .def_rw("roi_height", &FrameOptions::roi_height)
+      .def_rw("downsample", &FrameOptions::downsample)
+      .def_rw("pooling", &FrameOptions::pooling);
+
+  nb::class_<PacingStats>(m, "PacingStats")
+      .def_ro("batches", &PacingStats::batches)
+      .def_ro("late_batches", &PacingStats::late_batches)
+      .def_ro("mean_lag_us", &PacingStats::mean_lag_us)
+      .def_ro("max_lag_us", &PacingStats::max_lag_us)
+      .def_ro("mean_lead_us", &PacingStats::mean_lead_us)
+      .def_ro("max_lead_us", &PacingStats::max_lead_us);
+
   nb::class_<AER::Event>(m, "Event")
       .def(nb::init<uint64_t, uint16_t, uint16_t, bool>())
       .def_rw("timestamp", &AER::Event::timestamp)
@@ -68,31 +122,50 @@ NB_MODULE(aestream_ext, m) {
   //       .def("__iter__", [](Iterator &it) -> Iterator & { return it; })
   //       .def("__next__", &Iterator::next, nb::rv_policy::reference);
 
-  //   nb::class_<FrameIterator>(m , "FrameIterator")
-  //       .def("__iter__", [](FrameIterator &it) -> FrameIterator & { return
-  //       it; }) .def("__next__", &FrameIterator::next);
+  nb::class_<FrameIterator>(m, "FrameIterator")
+      .def("__iter__", [](FrameIterator &it) -> FrameIterator & { return it; },
+           nb::rv_policy::reference)
+      .def("__next__", &FrameIterator::next);
+
+  nb::class_<BatchIterator>(m, "BatchIterator")
+      .def("__iter__", [](BatchIterator &it) -> BatchIterator & { return it; },
+           nb::rv_policy::reference)
+      .def("__next__", &BatchIterator::next);
 
   //   nb::class_<PartIterator>(m, "PartIterator")
   //       .def("__iter__", [](PartIterator &it) -> PartIterator & { return it;
   //       }) .def("__next__", &PartIterator::next);
 
   nb::class_<FileInput>(m, "FileInput")
-      .def(nb::init<std::string, py_size_t, std::string, bool>(),
+      .def(nb::init<std::string, py_size_t, std::string, bool, double,
+                    const FrameOptions &>(),
            nb::arg("filename"), nb::arg("shape"), nb::arg("device") = "cpu",
-           nb::arg("ignore_time") = false)
+           nb::arg("ignore_time") = false, nb::arg("speed") = 1.0,
+           nb::arg("options") = FrameOptions())
       .def("__enter__", &FileInput::start_stream)
       .def("__exit__", &FileInput::stop_stream, nb::arg("a").none(),
            nb::arg("b").none(), nb::arg("c").none())
       .def("load_all", &FileInput::load)
-      //  .def("frames",
-      //       [](nb::object fobj, size_t n_events_per_part) {
-      //         return FrameIterator(fobj.cast<FileInput &>(),
-      //         n_events_per_part, fobj);
-      //       })
+      .def("read_into_buffer", &FileInput::read_into, nb::arg("out"))
+      .def("read_columns_into_buffer", &FileInput::read_columns_into,
+           nb::arg("timestamp"), nb::arg("x"), nb::arg("y"),
+           nb::arg("polarity"))
+      .def("frame_iterator", &FileInput::frames, nb::arg("window_us"),
+           nb::arg("stride_us").none() = nb::none(), nb::arg("prefetch") = 4,
+           nb::keep_alive<0, 1>())
+      .def("batch_iterator", &FileInput::batches, nb::arg("window_us"),
+           nb::arg("stride_us").none() = nb::none(), nb::arg("batch") = 32,
+           nb::keep_alive<0, 1>())
       //  .def("events_co", &FileInput::events_co)
       .def("is_streaming", &FileInput::get_is_streaming)
+      .def("pacing_stats", &FileInput::pacing_stats)
       .def("start_stream", &FileInput::start_stream)
       .def("stop_stream", &FileInput::stop_stream)
+      .def("read_events", &FileInput::read_events)
+      .def("read_sparse", &FileInput::read_sparse)
+      .def("wait", &FileInput::wait, nb::arg("min_events") = 0,
+           nb::arg("until_timestamp").none() = nb::none(),
+           nb::arg("timeout").none() = nb::none())
       .def("read_buffer", &FileInput::read)
       .def("read_genn",
            [](FileInput &file,
@@ -119,34 +192,121 @@ NB_MODULE(aestream_ext, m) {
   //  .def("__next__", &FileInput::begin)
   ;
 
+  nb::class_<UDPReceiveStats>(m, "UDPReceiveStats")
+      .def_ro("packets", &UDPReceiveStats::packets)
+      .def_ro("events", &UDPReceiveStats::events)
+      .def_ro("bytes", &UDPReceiveStats::bytes)
+      .def_ro("dropped_packets", &UDPReceiveStats::dropped_packets)
+      .def_ro("truncated_packets", &UDPReceiveStats::truncated_packets)
+      .def_ro("lost_packets", &UDPReceiveStats::lost_packets)
+      .def_ro("reordered_packets", &UDPReceiveStats::reordered_packets)
+      .def_ro("malformed_packets", &UDPReceiveStats::malformed_packets);
+
   nb::class_<UDPInput>(m, "UDPInput")
-      .def(nb::init<py_size_t, std::string, int>(), nb::arg("shape"),
-           nb::arg("device") = "cpu", nb::arg("port") = 3333)
+      .def(nb::init<py_size_t, std::string, int, size_t, int,
+                    const std::vector<std::string> &, const FrameOptions &>(),
+           nb::arg("shape"), nb::arg("device") = "cpu", nb::arg("port") = 3333,
+           nb::arg("threads") = 1, nb::arg("receive_buffer") = 0,
+           nb::arg("multicast_groups") = std::vector<std::string>(),
+           nb::arg("options") = FrameOptions())
       .def("__enter__", &UDPInput::start_stream)
       .def("__exit__", &UDPInput::stop_stream, nb::arg("a").none(),
            nb::arg("b").none(), nb::arg("c").none())
       .def("start_stream", &UDPInput::start_stream)
       .def("stop_stream", &UDPInput::stop_stream, nb::arg("a").none(),
            nb::arg("b").none(), nb::arg("c").none())
+      .def("read_events", &UDPInput::read_events)
+      .def("read_sparse", &UDPInput::read_sparse)
+      .def("wait", &UDPInput::wait, nb::arg("min_events") = 0,
+           nb::arg("until_timestamp").none() = nb::none(),
+           nb::arg("timeout").none() = nb::none())
       .def("read_buffer", &UDPInput::read)
+      .def("receive_stats", &UDPInput::stats)
       .def("read_genn",
            [](UDPInput &udp,
               nb::ndarray<uint32_t, nb::shape<-1>, nb::c_contig,
                           nb::device::cpu>
                   buffer) { udp.read_genn(buffer.data(), buffer.size()); });
 
+  nb::class_<SharedMemoryReceiveStats>(m, "SharedMemoryReceiveStats")
+      .def_ro("batches", &SharedMemoryReceiveStats::batches)
+      .def_ro("events", &SharedMemoryReceiveStats::events)
+      .def_ro("lost_batches", &SharedMemoryReceiveStats::lost_batches)
+      .def_ro("torn_batches", &SharedMemoryReceiveStats::torn_batches)
+      .def_ro("lag", &SharedMemoryReceiveStats::lag);
+
+  nb::class_<SharedMemoryInput>(m, "SharedMemoryInput")
+      .def(nb::init<py_size_t, std::string, std::string,
+                    const FrameOptions &>(),
+           nb::arg("shape"), nb::arg("device") = "cpu",
+           nb::arg("name") = "aestream", nb::arg("options") = FrameOptions())
+      .def("__enter__", &SharedMemoryInput::start_stream)
+      .def("__exit__", &SharedMemoryInput::stop_stream, nb::arg("a").none(),
+           nb::arg("b").none(), nb::arg("c").none())
+      .def("start_stream", &SharedMemoryInput::start_stream)
+      .def("stop_stream", &SharedMemoryInput::stop_stream,
+           nb::arg("a").none(), nb::arg("b").none(), nb::arg("c").none())
+      .def("read_events", &SharedMemoryInput::read_events)
+      .def("read_sparse", &SharedMemoryInput::read_sparse)
+      .def("wait", &SharedMemoryInput::wait, nb::arg("min_events") = 0,
+           nb::arg("until_timestamp").none() = nb::none(),
+           nb::arg("timeout").none() = nb::none())
+      .def("read_buffer", &SharedMemoryInput::read)
+      .def("receive_stats", &SharedMemoryInput::stats)
+      .def("read_genn",
+           [](SharedMemoryInput &shm,
+              nb::ndarray<uint32_t, nb::shape<-1>, nb::c_contig,
+                          nb::device::cpu>
+                  buffer) { shm.read_genn(buffer.data(), buffer.size()); });
+
+  nb::class_<StreamReceiveStats>(m, "StreamReceiveStats")
+      .def_ro("connections", &StreamReceiveStats::connections)
+      .def_ro("frames", &StreamReceiveStats::frames)
+      .def_ro("events", &StreamReceiveStats::events)
+      .def_ro("bytes", &StreamReceiveStats::bytes);
+
+  nb::class_<TCPInput>(m, "TCPInput")
+      .def(nb::init<py_size_t, std::string, int, std::string,
+                    const FrameOptions &>(),
+           nb::arg("shape"), nb::arg("device") = "cpu", nb::arg("port") = 3333,
+           nb::arg("path") = "", nb::arg("options") = FrameOptions())
+      .def("__enter__", &TCPInput::start_stream)
+      .def("__exit__", &TCPInput::stop_stream, nb::arg("a").none(),
+           nb::arg("b").none(), nb::arg("c").none())
+      .def("start_stream", &TCPInput::start_stream)
+      .def("stop_stream", &TCPInput::stop_stream, nb::arg("a").none(),
+           nb::arg("b").none(), nb::arg("c").none())
+      .def("read_events", &TCPInput::read_events)
+      .def("read_sparse", &TCPInput::read_sparse)
+      .def("wait", &TCPInput::wait, nb::arg("min_events") = 0,
+           nb::arg("until_timestamp").none() = nb::none(),
+           nb::arg("timeout").none() = nb::none())
+      .def("read_buffer", &TCPInput::read)
+      .def("receive_stats", &TCPInput::stats)
+      .def("read_genn",
+           [](TCPInput &tcp,
+              nb::ndarray<uint32_t, nb::shape<-1>, nb::c_contig,
+                          nb::device::cpu>
+                  buffer) { tcp.read_genn(buffer.data(), buffer.size()); });
+
 #if defined(WITH_CAER) || defined(WITH_METAVISION)
   nb::class_<USBInput>(m, "USBInput")
-      .def(nb::init<py_size_t, std::string, Camera>(), nb::arg("shape"),
-           nb::arg("device") = "cpu", nb::arg("camera") = Camera::Inivation)
+      .def(nb::init<py_size_t, std::string, Camera, const FrameOptions &>(),
+           nb::arg("shape"), nb::arg("device") = "cpu",
+           nb::arg("camera") = Camera::Inivation,
+           nb::arg("options") = FrameOptions())
 #ifdef WITH_CAER
-      .def(nb::init<py_size_t, std::string, int, int>(), nb::arg("shape"),
-           nb::arg("device") = "cpu", nb::arg("device_id") = 0,
-           nb::arg("device_address") = 0)
+      .def(nb::init<py_size_t, std::string, int, int, const FrameOptions &>(),
+           nb::arg("shape"), nb::arg("device") = "cpu",
+           nb::arg("device_id") = 0, nb::arg("device_address") = 0,
+           nb::arg("options") = FrameOptions())
 #endif
 #ifdef WITH_METAVISION
-      .def(nb::init<py_size_t, std::string, std::string>(), nb::arg("shape"),
-           nb::arg("device") = "cpu", nb::arg("serial_number") = nb::none())
+      .def(nb::init<py_size_t, std::string, std::string,
+                    const FrameOptions &>(),
+           nb::arg("shape"), nb::arg("device") = "cpu",
+           nb::arg("serial_number") = nb::none(),
+           nb::arg("options") = FrameOptions())
 
 #endif
       .def("__enter__", &USBInput::start_stream)
@@ -157,6 +317,11 @@ NB_MODULE(aestream_ext, m) {
            })
       .def("start_stream", &USBInput::start_stream)
       .def("stop_stream", &USBInput::stop_stream)
+      .def("read_events", &USBInput::read_events)
+      .def("read_sparse", &USBInput::read_sparse)
+      .def("wait", &USBInput::wait, nb::arg("min_events") = 0,
+           nb::arg("until_timestamp").none() = nb::none(),
+           nb::arg("timeout").none() = nb::none())
       .def("read_buffer", &USBInput::read, nb::rv_policy::take_ownership)
       .def("read_genn",
            [](USBInput &usb,
@@ -167,10 +332,12 @@ NB_MODULE(aestream_ext, m) {
 
 #ifdef WITH_ZMQ
   nb::class_<ZMQInput>(m, "SpeckInput")
-      .def(nb::init<py_size_t, std::string, std::string>(),
+      .def(nb::init<py_size_t, std::string, std::string,
+                    const FrameOptions &>(),
            nb::arg("shape") = std::vector<int>({128, 128}),
            nb::arg("device") = "cpu",
-           nb::arg("address") = "tcp://0.0.0.0:40001")
+           nb::arg("address") = "tcp://0.0.0.0:40001",
+           nb::arg("options") = FrameOptions())
       .def("__enter__", &ZMQInput::start_stream)
       .def("__exit__",
            [](ZMQInput &i, nb::object t, nb::object v, nb::object trace) {
@@ -179,6 +346,11 @@ NB_MODULE(aestream_ext, m) {
            })
       .def("start_stream", &ZMQInput::start_stream)
       .def("stop_stream", &ZMQInput::stop_stream)
+      .def("read_events", &ZMQInput::read_events)
+      .def("read_sparse", &ZMQInput::read_sparse)
+      .def("wait", &ZMQInput::wait, nb::arg("min_events") = 0,
+           nb::arg("until_timestamp").none() = nb::none(),
+           nb::arg("timeout").none() = nb::none())
       .def("read_buffer", &ZMQInput::read, nb::rv_policy::take_ownership)
       .def("read_genn",
            [](ZMQInput &zmq,
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+#include "../cpp/input/shm.hpp"
+#include "tensor_buffer.hpp"
+
+/**
+ * What a SharedMemoryInput read. Lost batches were overwritten before they
+ * could be read, because the input fell a whole ring behind the producer,
+ * and torn batches were overwritten while they were copied out, and were
+ * dropped. Lag counts the batches published but not yet read.
+ */
+struct SharedMemoryReceiveStats {
+  uint64_t batches = 0;
+  uint64_t events = 0;
+  uint64_t lost_batches = 0;
+  uint64_t torn_batches = 0;
+  uint64_t lag = 0;
+};
+
+class SharedMemoryInput {
+private:
+  std::unique_ptr<TensorBufferBase> buffer;
+  const std::string name;
+  // Events handed to the buffer at a time, which bounds its device buffers
+  static const size_t BATCH_EVENTS = 65536;
+  // How often the reading thread checks whether to stop, and looks for a
+  // producer while there is none
+  static constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+
+  std::thread reader_thread;
+  std::atomic<bool> is_serving = {true};
+
+  std::atomic<uint64_t> batches = 0;
+  std::atomic<uint64_t> events = 0;
+  std::atomic<uint64_t> lost = 0;
+  std::atomic<uint64_t> torn = 0;
+  std::atomic<uint64_t> lag = 0;
+
+public:
+  SharedMemoryInput(py_size_t shape, const std::string &device,
+                    const std::string &name,
+                    const FrameOptions &options = FrameOptions())
+      : buffer(make_tensor_buffer(shape, device, BATCH_EVENTS, options)),
+        name(name) {}
+
+  ~SharedMemoryInput() { stop(); }
+
+  SharedMemoryInput *start_stream() {
+    reader_thread = std::thread(&SharedMemoryInput::read_synchronous, this);
+    return this;
+  }
+
+  std::unique_ptr<BufferPointer> read() { return buffer->read(); }
+  void read_genn(uint32_t *bitmask, size_t size) {
+    buffer->read_genn(bitmask, size);
+  }
+  nb::dict read_events() { return buffer->read_events(); }
+  nb::tuple read_sparse() { return buffer->read_sparse(); }
+  bool wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+            std::optional<double> timeout) {
+    nb::gil_scoped_release release;
+    return buffer->wait(min_events, until_timestamp, timeout);
+  }
+
+  SharedMemoryReceiveStats stats() const {
+    return {batches.load(), events.load(), lost.load(), torn.load(),
+            lag.load()};
+  }
+
+  // Attaches to the ring of a producer, waiting for one to start, and
+  // accumulates its batches. Attaches again when a producer replaces the
+  // ring.
+  void read_synchronous() {
+    // Batches are copied out of the ring before they are accumulated, so
+    // ones the producer overwrote meanwhile never reach the frames
+    std::vector<AER::Event> staging;
+    while (is_serving.load()) {
+      std::unique_ptr<ShmRingReader> reader;
+      try {
+        reader = std::make_unique<ShmRingReader>(name);
+      } catch (const std::runtime_error &) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+        continue;
+      }
+      const uint64_t lost_before = lost.load();
+      const uint64_t torn_before = torn.load();
+      std::span<const AER::Event> batch;
+      while (is_serving.load()) {
+        const auto status = reader->next(batch, POLL_INTERVAL);
+        if (status == ShmRingReader::Status::Closed) {
+          break;
+        } else if (status == ShmRingReader::Status::Timeout) {
+          continue;
+        }
+        staging.assign(batch.begin(), batch.end());
+        const bool intact = reader->intact();
+        if (intact) {
+          const std::span<const AER::Event> copy = staging;
+          for (size_t start = 0; start < copy.size(); start += BATCH_EVENTS) {
+            buffer->set_events(copy.subspan(
+                start, std::min(BATCH_EVENTS, copy.size() - start)));
+          }
+          batches++;
+          events += copy.size();
+        }
+        lost.store(lost_before + reader->lost_batches());
+        torn.store(torn_before + reader->torn_batches());
+        lag.store(reader->lag());
+      }
+    }
+    buffer->finish();
+  }
+
+  void stop() {
+    is_serving.store(false);
+    buffer->finish();
+    if (reader_thread.joinable()) {
+      reader_thread.join();
+    }
+  }
+
+  void stop_stream(nb::object &a, nb::object &b, nb::object &c) {
+    nb::gil_scoped_release release;
+    stop();
+  }
+};
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "types.hpp"
+
+#include "../cpp/input/stream.hpp"
+#include "tensor_buffer.hpp"
+
+/**
+ * What a TCPInput received. Frames and bytes count what arrived on every
+ * connection, one after another.
+ */
+struct StreamReceiveStats {
+  uint64_t connections = 0;
+  uint64_t frames = 0;
+  uint64_t events = 0;
+  uint64_t bytes = 0;
+};
+
+class TCPInput {
+private:
+  std::unique_ptr<TensorBufferBase> buffer;
+  const int port;
+  const std::string path;
+  // Events handed to the buffer at a time, which bounds its device buffers
+  static const size_t BATCH_EVENTS = 65536;
+
+  int listener = -1;
+  std::thread socket_thread;
+  std::atomic<bool> is_serving = {true};
+
+  std::atomic<uint64_t> connections = 0;
+  std::atomic<uint64_t> frames = 0;
+  std::atomic<uint64_t> events = 0;
+  std::atomic<uint64_t> bytes = 0;
+
+public:
+  /// Listens on a Unix domain socket at the path if one is given, and on
+  /// the TCP port otherwise
+  TCPInput(py_size_t shape, const std::string &device, int port = 3333,
+           const std::string &path = "",
+           const FrameOptions &options = FrameOptions())
+      : buffer(make_tensor_buffer(shape, device, BATCH_EVENTS, options)),
+        port(port), path(path) {}
+
+  ~TCPInput() { stop(); }
+
+  TCPInput *start_stream() {
+    // Bind in the caller, so failures raise in Python
+    listener = path.empty() ? listen_tcp(std::to_string(port))
+                            : listen_unix(path);
+    socket_thread = std::thread(&TCPInput::serve_synchronous, this);
+    return this;
+  }
+
+  std::unique_ptr<BufferPointer> read() { return buffer->read(); }
+  void read_genn(uint32_t *bitmask, size_t size) {
+    buffer->read_genn(bitmask, size);
+  }
+  nb::dict read_events() { return buffer->read_events(); }
+  nb::tuple read_sparse() { return buffer->read_sparse(); }
+  bool wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+            std::optional<double> timeout) {
+    nb::gil_scoped_release release;
+    return buffer->wait(min_events, until_timestamp, timeout);
+  }
+
+  StreamReceiveStats stats() const {
+    return {connections.load(), frames.load(), events.load(), bytes.load()};
+  }
+
+  // Accepts one sender after another, and hands the events of their frames
+  // to the buffer as they were read from the socket
+  void serve_synchronous() {
+    std::vector<AER::Event> received;
+    received.reserve(BATCH_EVENTS);
+    int sockfd;
+    while ((sockfd = accept_stream(listener, is_serving)) != -1) {
+      connections++;
+      FrameReader reader(sockfd, BATCH_EVENTS);
+      uint64_t counted_frames = 0, counted_bytes = 0;
+      try {
+        while (reader.read(received, is_serving)) {
+          buffer->set_vector(received);
+          events += received.size();
+          frames += reader.frames() - counted_frames;
+          bytes += reader.bytes() - counted_bytes;
+          counted_frames = reader.frames();
+          counted_bytes = reader.bytes();
+        }
+      } catch (const std::runtime_error &e) {
+        fprintf(stderr, "%s\n", e.what());
+      }
+      close(sockfd);
+    }
+    close(listener);
+    if (!path.empty()) {
+      unlink(path.c_str());
+    }
+    buffer->finish();
+  }
+
+  void stop() {
+    is_serving.store(false);
+    buffer->finish();
+    if (socket_thread.joinable()) {
+      socket_thread.join();
+    }
+  }
+
+  void stop_stream(nb::object &a, nb::object &b, nb::object &c) {
+    nb::gil_scoped_release release;
+    stop();
+  }
+};
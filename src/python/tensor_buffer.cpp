@@ -1,3 +1,12 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
 #include "tensor_buffer.hpp"
 
 namespace nb = nanobind;
@@ -18,157 +27,889 @@ allocate_buffer(const size_t &length, std::string device) {
       new scalar_t[length]{0}, delete_cpu_buffer<scalar_t>);
 }
 
+inline std::vector<size_t> get_frame_shape(const std::vector<size_t> &size,
+                                           const FrameOptions &options) {
+  // Rotating by 90 or 270 degrees swaps width and height
+  const bool rotated = options.rotation % 180 != 0;
+  const size_t width = rotated ? size[1] : size[0];
+  const size_t height = rotated ? size[0] : size[1];
+  std::vector<size_t> plane = {width, height};
+  if (options.layout == Layout::HW) {
+    plane = {height, width};
+  }
+  std::vector<size_t> frame_shape;
+  if (options.mode == FrameMode::Voxel) {
+    frame_shape.push_back(options.bins);
+  }
+  const bool has_channels = options.mode == FrameMode::Polarity ||
+                            options.mode == FrameMode::Voxel;
+  if (has_channels && !options.channels_last) {
+    frame_shape.push_back(2);
+  }
+  frame_shape.insert(frame_shape.end(), plane.begin(), plane.end());
+  if (has_channels && options.channels_last) {
+    frame_shape.push_back(2);
+  }
+  return frame_shape;
+}
+
+inline Region get_region(const std::vector<size_t> &size,
+                         const FrameOptions &options) {
+  if (options.roi_x >= size[0] || options.roi_y >= size[1]) {
+    throw std::invalid_argument("The region of interest starts off the sensor");
+  }
+  const size_t width =
+      options.roi_width ? options.roi_width : size[0] - options.roi_x;
+  const size_t height =
+      options.roi_height ? options.roi_height : size[1] - options.roi_y;
+  if (options.roi_x + width > size[0] || options.roi_y + height > size[1]) {
+    throw std::invalid_argument("The region of interest exceeds the sensor");
+  }
+  const size_t factor = std::min<size_t>(options.downsample, UINT16_MAX);
+  return Region(options.roi_x, options.roi_y, width, height, factor);
+}
+
+PixelMap::PixelMap(const std::vector<size_t> &size, const Region &region,
+                   const FrameOptions &options)
+    : columns(size[0], OUTSIDE), rows(size[1], OUTSIDE) {
+  if (options.rotation % 90 != 0 || options.rotation < 0 ||
+      options.rotation >= 360) {
+    throw std::invalid_argument("Rotations must be 0, 90, 180 or 270 degrees");
+  }
+  for (size_t x = region.x; x < region.x + region.width; x++) {
+    columns[x] = region.scale_x(x);
+  }
+  for (size_t y = region.y; y < region.y + region.height; y++) {
+    rows[y] = region.scale_y(y);
+  }
+  const int64_t width = region.scaled_width();
+  const int64_t height = region.scaled_height();
+  // Express the oriented coordinates as u = u0 + ux * x + uy * y and
+  // v = v0 + vx * x + vy * y, starting with the flips
+  int64_t x0 = options.flip_x ? width - 1 : 0;
+  int64_t xx = options.flip_x ? -1 : 1;
+  int64_t y0 = options.flip_y ? height - 1 : 0;
+  int64_t yy = options.flip_y ? -1 : 1;
+  int64_t u0 = x0, ux = xx, uy = 0, v0 = y0, vx = 0, vy = yy;
+  int64_t oriented_width = width, oriented_height = height;
+  switch (options.rotation) {
+  case 90: // (x, y) -> (H - 1 - y, x)
+    u0 = height - 1 - y0, ux = 0, uy = -yy, v0 = x0, vx = xx, vy = 0;
+    std::swap(oriented_width, oriented_height);
+    break;
+  case 180: // (x, y) -> (W - 1 - x, H - 1 - y)
+    u0 = width - 1 - x0, ux = -xx, v0 = height - 1 - y0, vy = -yy;
+    break;
+  case 270: // (x, y) -> (y, W - 1 - x)
+    u0 = y0, ux = 0, uy = yy, v0 = width - 1 - x0, vx = -xx, vy = 0;
+    std::swap(oriented_width, oriented_height);
+    break;
+  }
+  // Then lay the oriented pixels out x-major or row-major
+  const int64_t u_stride =
+      options.layout == Layout::WH ? oriented_height : 1;
+  const int64_t v_stride = options.layout == Layout::WH ? 1 : oriented_width;
+  origin = u0 * u_stride + v0 * v_stride;
+  x_stride = ux * u_stride + vx * v_stride;
+  y_stride = uy * u_stride + vy * v_stride;
+}
+
+// Time of events without timestamps, such as those in UDP packets
+inline uint64_t arrival_timestamp() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+TensorBufferBase::TensorBufferBase(std::vector<size_t> size,
+                                   const FrameOptions &options)
+    : shape(size), options(options), region(get_region(size, options)),
+      frame_shape(get_frame_shape(
+          {region.scaled_width(), region.scaled_height()}, options)),
+      plane_size(region.scaled_width() * region.scaled_height()),
+      pixels(size, region, options),
+      pixel_stride(options.channels_last ? 2 : 1),
+      channel_stride(options.channels_last ? 1 : plane_size) {
+  if (options.record_events) {
+    event_store = std::make_shared<EventStore>();
+  }
+}
+
+nb::dict TensorBufferBase::read_events() {
+  if (!event_store) {
+    throw std::runtime_error("Events are only kept with record_events=True");
+  }
+  return event_store->read_events();
+}
+
+nb::tuple TensorBufferBase::read_sparse() {
+  if (!event_store) {
+    throw std::runtime_error("Events are only kept with record_events=True");
+  }
+  return event_store->read_sparse();
+}
+
+std::vector<EventStore *> TensorBufferBase::shard_stores(
+    const std::vector<std::unique_ptr<TensorBufferBase>> &shards) {
+  std::vector<EventStore *> stores;
+  for (const auto &shard : shards) {
+    if (!shard->event_store) {
+      throw std::runtime_error(
+          "Events are only kept with record_events=True");
+    }
+    stores.push_back(shard->event_store.get());
+  }
+  return stores;
+}
+
+nb::dict TensorBufferBase::read_events(
+    const std::vector<std::unique_ptr<TensorBufferBase>> &shards) {
+  return EventStore::read_events(shard_stores(shards));
+}
+
+nb::tuple TensorBufferBase::read_sparse(
+    const std::vector<std::unique_ptr<TensorBufferBase>> &shards) {
+  return EventStore::read_sparse(shard_stores(shards));
+}
+
+bool TensorBufferBase::wait(size_t min_events,
+                            std::optional<uint64_t> until_timestamp,
+                            std::optional<double> timeout) {
+  Arrivals &state = *arrivals;
+  const auto is_ready = [&] {
+    return state.finished.load() ||
+           (state.received_events.load() - state.frame_start.load() >=
+                min_events &&
+            state.current_timestamp.load() >= until_timestamp.value_or(0));
+  };
+  // Register before checking, so the producer cannot miss us
+  state.waiters++;
+  bool ready = true;
+  {
+    std::unique_lock lock{state.wait_lock};
+    if (timeout) {
+      ready = state.frame_ready.wait_for(
+          lock, std::chrono::duration<double>(*timeout), is_ready);
+    } else {
+      state.frame_ready.wait(lock, is_ready);
+    }
+  }
+  state.waiters--;
+  return ready;
+}
+
+void TensorBufferBase::finish() {
+  arrivals->finished.store(true);
+  {
+    const std::lock_guard lock{arrivals->wait_lock};
+  }
+  arrivals->frame_ready.notify_all();
+}
+
+void TensorBufferBase::notify_received(size_t count, uint64_t timestamp) {
+  if (count == 0) {
+    return;
+  }
+  Arrivals &state = *arrivals;
+  state.current_timestamp.store(timestamp);
+  state.received_events.fetch_add(count);
+  // Only wake readers that wait, and only take the lock when there are any
+  if (state.waiters.load() > 0) {
+    {
+      const std::lock_guard lock{state.wait_lock};
+    }
+    state.frame_ready.notify_all();
+  }
+}
+
 // TensorBuffer constructor
-TensorBuffer::TensorBuffer(std::vector<size_t> size, std::string device,
-                           size_t buffer_size)
-    : shape(size), device(device) {
-#ifdef USE_CUDA // Initialize CUDA buffers
+template <typename scalar_t>
+TensorBuffer<scalar_t>::TensorBuffer(std::vector<size_t> size,
+                                     std::string device, size_t buffer_size,
+                                     const FrameOptions &options)
+    : TensorBufferBase(size, options), device(device) {
+  if (device == "cuda" && !std::is_same_v<scalar_t, float>) {
+    throw std::invalid_argument("CUDA frames require float32 elements");
+  }
+  if (options.pooling == Pooling::Any &&
+      (options.mode == FrameMode::Voxel || options.mode == FrameMode::Surface)) {
+    throw std::invalid_argument(
+        "Any-pooling applies to count, polarity, signed and binary frames");
+  }
+  if (options.mode == FrameMode::Voxel) {
+    if (options.bins == 0 || options.window_us == 0) {
+      throw std::invalid_argument(
+          "Voxel frames require at least one bin and a positive window");
+    }
+    bin_scale = static_cast<float>(options.bins - 1) / options.window_us;
+    bin_positions.reserve(buffer_size);
+  } else if (options.mode == FrameMode::Surface) {
+    if (options.tau_us <= 0) {
+      throw std::invalid_argument("Time surfaces require a positive tau");
+    }
+    last_timestamps =
+        std::make_unique<std::atomic<uint64_t>[]>(plane_size);
+    for (size_t i = 0; i < plane_size; i++) {
+      last_timestamps[i].store(NO_EVENT, std::memory_order_relaxed);
+    }
+  }
+#ifdef USE_CUDA // Initialize CUDA buffers, with room for two bins per event
   if (device == "cuda") {
-    cuda_buffer = allocate_buffer<int>(buffer_size, device);
-    offset_buffer = std::vector<int>(buffer_size);
+    staging_capacity = 2 * std::max<size_t>(buffer_size, 1);
+    cuda_buffer = allocate_buffer<int>(staging_capacity, device);
+    cuda_values = allocate_buffer<float>(staging_capacity, device);
+    offset_buffer.reserve(staging_capacity);
+    value_buffer.reserve(staging_capacity);
   }
 #endif
+  switch (options.mode) {
+  case FrameMode::Count:
+    select_kernels<FrameMode::Count>();
+    break;
+  case FrameMode::Polarity:
+    select_kernels<FrameMode::Polarity>();
+    break;
+  case FrameMode::Signed:
+    if constexpr (std::is_signed_v<scalar_t>) {
+      select_kernels<FrameMode::Signed>();
+      break;
+    }
+    throw std::invalid_argument("Signed frames require a signed dtype");
+  case FrameMode::Binary:
+    select_kernels<FrameMode::Binary>();
+    break;
+  case FrameMode::Voxel:
+    if constexpr (std::is_same_v<scalar_t, float>) {
+      select_kernels<FrameMode::Voxel>();
+      break;
+    }
+    throw std::invalid_argument("Voxel frames require float32 elements");
+  case FrameMode::Surface:
+    if constexpr (std::is_same_v<scalar_t, float>) {
+      select_kernels<FrameMode::Surface>();
+      break;
+    }
+    throw std::invalid_argument("Time surfaces require float32 elements");
+  default:
+    throw std::invalid_argument("Unknown frame mode");
+  }
   // If device is GeNN, allocate suitably sized bitmask
   if (device == "genn") {
+    if (plane_size != shape[0] * shape[1]) {
+      throw std::invalid_argument(
+          "GeNN bitmasks cannot be cropped or downsampled");
+    }
+    size_t bitmask_words;
     if (shape.size() == 3) {
-      const size_t bitmask_words = ((shape[0] * shape[1] * shape[2]) + 31) / 32;
-      genn_events.resize(bitmask_words, 0);
+      bitmask_words = ((shape[0] * shape[1] * shape[2]) + 31) / 32;
     } else if (shape.size() == 2) {
-      const size_t bitmask_words = ((shape[0] * shape[1]) + 31) / 32;
-      genn_events.resize(bitmask_words, 0);
+      bitmask_words = ((shape[0] * shape[1]) + 31) / 32;
     } else {
       throw std::runtime_error("Unsupported shape");
     }
+    genn_events1.resize(bitmask_words, 0);
+    genn_events2.resize(bitmask_words, 0);
+    genn_slot.exchange(&genn_events1);
+    genn_spare = &genn_events2;
   } else {
-    buffer1 = allocate_buffer<float>(size[0] * size[1], device);
-    buffer2 = allocate_buffer<float>(size[0] * size[1], device);
+    size_t length = 1;
+    for (const auto dim : frame_shape) {
+      length *= dim;
+    }
+    pool = std::make_shared<BufferPool>(length * sizeof(scalar_t), device);
+    buffer_slot.exchange(pool->acquire());
   }
 }
 
-void TensorBuffer::set_buffer(uint16_t data[], int numbytes) {
-  const auto length = numbytes >> 1;
-  const std::lock_guard lock{buffer_lock};
+template <typename scalar_t>
+TensorBuffer<scalar_t>::~TensorBuffer() {
+  if (buffer_slot.get()) {
+    buffer_slot.get()->release();
+  }
+}
+
+template <typename scalar_t>
+template <FrameMode mode> void TensorBuffer<scalar_t>::select_kernels() {
+  // Pooling is fixed per buffer, so the kernels test it at compile time
+  if constexpr (mode != FrameMode::Binary && mode != FrameMode::Voxel &&
+                mode != FrameMode::Surface) {
+    if (options.pooling == Pooling::Any) {
+      select_device_kernels<mode, Pooling::Any>();
+      return;
+    }
+  }
+  select_device_kernels<mode, Pooling::Sum>();
+}
+
+template <typename scalar_t>
+template <FrameMode mode, Pooling pooling>
+void TensorBuffer<scalar_t>::select_device_kernels() {
+  if constexpr (std::is_same_v<scalar_t, float>) {
+    if (device == "cuda") {
+      vector_kernel = &TensorBuffer::accumulate_events<
+          mode, pooling, true, std::span<const AER::Event>>;
+      packet_kernel = &TensorBuffer::accumulate_packet<mode, pooling, true>;
+      timed_kernel =
+          &TensorBuffer::accumulate_events<mode, pooling, true, TimedPacket>;
+      return;
+    }
+  }
+  vector_kernel = &TensorBuffer::accumulate_events<
+      mode, pooling, false, std::span<const AER::Event>>;
+  packet_kernel = &TensorBuffer::accumulate_packet<mode, pooling, false>;
+  timed_kernel =
+      &TensorBuffer::accumulate_events<mode, pooling, false, TimedPacket>;
+}
+
+template <typename scalar_t>
+template <FrameMode mode>
+inline size_t TensorBuffer<scalar_t>::event_offset(uint16_t x, uint16_t y,
+                                                   bool polarity) const {
+  if constexpr (mode == FrameMode::Polarity) {
+    return pixels(x, y) * pixel_stride + polarity * channel_stride;
+  } else {
+    return pixels(x, y);
+  }
+}
+
+template <FrameMode mode> inline float event_value(bool polarity) {
+  if constexpr (mode == FrameMode::Signed) {
+    return 2.0f * polarity - 1.0f;
+  } else {
+    return 1.0f;
+  }
+}
+
+// Adds to a frame element, saturating integers and setting booleans
+template <typename scalar_t>
+inline void add_value(scalar_t &element, float value) {
+  if constexpr (std::is_same_v<scalar_t, bool>) {
+    element = true;
+  } else if constexpr (std::is_integral_v<scalar_t>) {
+    const int32_t sum = element + static_cast<int32_t>(value);
+    element = std::clamp<int32_t>(sum, std::numeric_limits<scalar_t>::min(),
+                                  std::numeric_limits<scalar_t>::max());
+  } else {
+    element += value;
+  }
+}
+
+template <typename scalar_t>
+template <FrameMode mode, Pooling pooling, bool on_device>
+inline void TensorBuffer<scalar_t>::assign_event(scalar_t *array, uint16_t x,
+                                                 uint16_t y, bool polarity) {
+  const size_t offset = event_offset<mode>(x, y, polarity);
+  if constexpr (on_device) { // Gather events for a single kernel launch
 #ifdef USE_CUDA
-  if (device == "cuda") {
+    stage<mode, pooling>(array, offset, event_value<mode>(polarity));
+#endif
+  } else if constexpr (mode == FrameMode::Binary) {
+    array[offset] = 1;
+  } else if constexpr (pooling == Pooling::Any) {
+    array[offset] = event_value<mode>(polarity);
+  } else {
+    add_value(array[offset], event_value<mode>(polarity));
+  }
+}
+
+template <typename scalar_t>
+template <bool on_device>
+inline void TensorBuffer<scalar_t>::assign_voxel(scalar_t *array, uint16_t x,
+                                                 uint16_t y, bool polarity,
+                                                 float position) {
+  // Split the event bilinearly between the two nearest bins. The last bin
+  // takes a zero weight as its own upper neighbour, which avoids a branch.
+  const size_t lower = static_cast<size_t>(position);
+  const size_t upper = std::min(lower + 1, options.bins - 1);
+  const float upper_weight = position - lower;
+  const size_t offset =
+      pixels(x, y) * pixel_stride + polarity * channel_stride;
+  const size_t lower_offset = offset + lower * 2 * plane_size;
+  const size_t upper_offset = offset + upper * 2 * plane_size;
+  if constexpr (on_device) {
+#ifdef USE_CUDA
+    stage<FrameMode::Voxel, Pooling::Sum>(array, lower_offset, 1 - upper_weight);
+    stage<FrameMode::Voxel, Pooling::Sum>(array, upper_offset, upper_weight);
+#endif
+  } else {
+    add_value(array[lower_offset], 1 - upper_weight);
+    add_value(array[upper_offset], upper_weight);
+  }
+}
+
+// Position of an event between the first and the last bin of its window.
+// Events older than the window count towards its first bin.
+template <typename scalar_t>
+inline float TensorBuffer<scalar_t>::bin_position(uint64_t window_start,
+                                                  uint64_t timestamp) const {
+  const float position =
+      static_cast<int64_t>(timestamp - window_start) * bin_scale;
+  return std::clamp(position, 0.0f, static_cast<float>(options.bins - 1));
+}
+
+// Moves a voxel frame on to the window holding an event past its own, and
+// clears the windows that were not read in time. Returns the new start.
+template <typename scalar_t>
+template <bool on_device>
+uint64_t TensorBuffer<scalar_t>::roll_window(PooledBuffer *frame,
+                                            uint64_t timestamp) {
+  const uint64_t windows =
+      (timestamp - *frame->window_start) / options.window_us;
+  frame->window_start = *frame->window_start + windows * options.window_us;
+#ifdef USE_CUDA
+  if constexpr (on_device) {
     offset_buffer.clear();
-    offset_buffer.reserve(length);
-    for (int i = 0; i < length; i = i + 2) {
-      // Decode x, y
-      const uint16_t y_coord = data[i] & 0x7FFF;
-      const uint16_t x_coord = data[i + 1] & 0x7FFF;
-      offset_buffer.push_back(shape[1] * x_coord + y_coord);
+    value_buffer.clear();
+    clear_memory_cuda(frame->data, frame_bytes());
+    return *frame->window_start;
+  }
+#endif
+  std::memset(frame->data, 0, frame_bytes());
+  return *frame->window_start;
+}
+
+template <typename scalar_t>
+inline void TensorBuffer<scalar_t>::assign_timestamp(uint16_t x, uint16_t y,
+                                                     uint64_t timestamp) {
+  last_timestamps[pixels(x, y)].store(timestamp, std::memory_order_relaxed);
+}
+
+// Batches larger than the device buffers, such as large UDP packets, launch
+// a kernel each time the staged updates fill them
+template <typename scalar_t>
+template <FrameMode mode, Pooling pooling>
+inline void TensorBuffer<scalar_t>::stage(scalar_t *array, size_t offset,
+                                          float value) {
+#ifdef USE_CUDA
+  if (offset_buffer.size() == staging_capacity) {
+    flush_events<mode, pooling, true>(array);
+  }
+  offset_buffer.push_back(offset);
+  value_buffer.push_back(value);
+#endif
+}
+
+template <typename scalar_t>
+template <FrameMode mode, Pooling pooling, bool on_device>
+inline void TensorBuffer<scalar_t>::flush_events(scalar_t *array) {
+#ifdef USE_CUDA
+  if constexpr (on_device) {
+    index_add_cuda(array, offset_buffer.data(), value_buffer.data(),
+                   offset_buffer.size(), cuda_buffer.get(), cuda_values.get(),
+                   mode == FrameMode::Binary || pooling == Pooling::Any);
+    offset_buffer.clear();
+    value_buffer.clear();
+  }
+#endif
+}
+
+template <typename scalar_t>
+template <FrameMode mode, Pooling pooling, bool on_device, typename Events>
+void TensorBuffer<scalar_t>::accumulate_events(PooledBuffer *frame,
+                                               const Events &events) {
+  scalar_t *array = static_cast<scalar_t *>(frame->data);
+  if constexpr (mode == FrameMode::Surface) {
+    // Only record event times; the surface is computed when it is read
+    for (size_t i = 0; i < events.size(); i++) {
+      const AER::Event event = events[i];
+      if (pixels.contains(event.x, event.y)) {
+        assign_timestamp(event.x, event.y, event.timestamp);
+      }
     }
-    index_increment_cuda(buffer1.get(), offset_buffer.data(),
-                         offset_buffer.size(), cuda_buffer.get());
     return;
+  } else if constexpr (mode == FrameMode::Voxel) {
+    if (events.empty()) {
+      return;
+    }
+    // The window of a frame starts at the time of its first event
+    uint64_t window_start =
+        frame->window_start.value_or(events.front().timestamp);
+    frame->window_start = window_start;
+    bin_positions.resize(events.size());
+    size_t begin = 0;
+    while (begin < events.size()) {
+      // Compute the bin positions first, in a loop the compiler can
+      // vectorize, then scatter the weights up to the end of the window
+      for (size_t i = begin; i < events.size(); i++) {
+        bin_positions[i] = bin_position(window_start, events[i].timestamp);
+      }
+      const uint64_t window_end = window_start + options.window_us;
+      for (; begin < events.size(); begin++) {
+        const AER::Event event = events[begin];
+        if (event.timestamp >= window_end) {
+          window_start = roll_window<on_device>(frame, event.timestamp);
+          break;
+        }
+        if (pixels.contains(event.x, event.y)) {
+          assign_voxel<on_device>(array, event.x, event.y, event.polarity,
+                                  bin_positions[begin]);
+        }
+      }
+    }
+  } else {
+    for (size_t i = 0; i < events.size(); i++) {
+      const AER::Event event = events[i];
+      if (pixels.contains(event.x, event.y)) {
+        assign_event<mode, pooling, on_device>(array, event.x, event.y,
+                                               event.polarity);
+      }
+    }
+  }
+  flush_events<mode, pooling, on_device>(array);
+}
+
+template <typename scalar_t>
+template <FrameMode mode, Pooling pooling, bool on_device>
+void TensorBuffer<scalar_t>::accumulate_packet(PooledBuffer *frame,
+                                               const uint16_t *data,
+                                               int length) {
+  scalar_t *array = static_cast<scalar_t *>(frame->data);
+  [[maybe_unused]] float position = 0;
+  // Packets carry no timestamps, so their events are timed on arrival
+  [[maybe_unused]] uint64_t now = 0;
+  if constexpr (mode == FrameMode::Voxel || mode == FrameMode::Surface) {
+    now = arrival_timestamp();
+  }
+  if constexpr (mode == FrameMode::Voxel) {
+    frame->window_start = frame->window_start.value_or(now);
+    if (now >= *frame->window_start + options.window_us) {
+      roll_window<on_device>(frame, now);
+    }
+    position = bin_position(*frame->window_start, now);
+  }
+  for (int i = 0; i < length; i = i + 2) {
+    // Decode x, y and the polarity stored in the high bit of y
+    const uint16_t y_coord = data[i] & 0x7FFF;
+    const uint16_t x_coord = data[i + 1] & 0x7FFF;
+    const bool polarity = data[i] & 0x8000;
+    // Drop events outside the region, or the sensor, before they are written
+    if (!pixels.contains(x_coord, y_coord)) {
+      continue;
+    }
+    if constexpr (mode == FrameMode::Surface) {
+      assign_timestamp(x_coord, y_coord, now);
+    } else if constexpr (mode == FrameMode::Voxel) {
+      assign_voxel<on_device>(array, x_coord, y_coord, polarity, position);
+    } else {
+      assign_event<mode, pooling, on_device>(array, x_coord, y_coord,
+                                             polarity);
+    }
+  }
+  flush_events<mode, pooling, on_device>(array);
+}
+
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::set_buffer(uint16_t data[], int numbytes) {
+  const auto length = numbytes >> 1;
+  const uint64_t now = arrival_timestamp();
+  if (event_store) {
+    event_store->append_packet(data, length, now);
   }
-#endif
   if (device == "genn") {
+    auto genn_events = genn_slot.begin_write();
     // Loop through events
     for (int i = 0; i < length; i = i + 2) {
       // Decode x, y coordinates and set event in GeNN format
       const int y_coord = data[i] & 0x7FFF;
       const int x_coord = data[i + 1] & 0x7FFF;
-      set_genn_event(x_coord, y_coord, true);
+      set_genn_event(*genn_events, x_coord, y_coord, true);
     }
+    genn_slot.end_write();
   } else {
-    for (int i = 0; i < length; i = i + 2) {
-      // Decode x, y
-      const int16_t y_coord = data[i] & 0x7FFF;
-      const int16_t x_coord = data[i + 1] & 0x7FFF;
-      assign_event(buffer1.get(), x_coord, y_coord);
-    }
+    (this->*packet_kernel)(buffer_slot.begin_write(), data, length);
+    buffer_slot.end_write();
   }
+  notify_received(length / 2, now);
 }
 
-void TensorBuffer::set_vector(std::vector<AER::Event> &events) {
-  const std::lock_guard lock{buffer_lock};
-#ifdef USE_CUDA
-  if (device == "cuda") {
-    offset_buffer.clear();
-    offset_buffer.reserve(events.size());
-    for (size_t i = 0; i < events.size(); i++) {
-      offset_buffer.push_back(shape[1] * events[i].x + events[i].y);
-    }
-    index_increment_cuda(buffer1.get(), offset_buffer.data(),
-                         offset_buffer.size(), cuda_buffer.get());
-    return;
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::set_vector(std::vector<AER::Event> &events) {
+  set_events(events);
+}
+
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::set_events(std::span<const AER::Event> events) {
+  if (event_store) {
+    event_store->append(events);
   }
-#endif
   if (device == "genn") {
+    auto genn_events = genn_slot.begin_write();
     // Loop through events
     for (const auto &event : events) {
-      set_genn_event(event.x, event.y, event.polarity);
+      set_genn_event(*genn_events, event.x, event.y, event.polarity);
     }
+    genn_slot.end_write();
   } else {
-    for (auto event : events) {
-      assign_event(buffer1.get(), event.x, event.y);
+    (this->*vector_kernel)(buffer_slot.begin_write(), events);
+    buffer_slot.end_write();
+  }
+  if (!events.empty()) {
+    notify_received(events.size(), events.back().timestamp);
+  }
+}
+
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::set_packet(const TimedPacket &packet) {
+  if (event_store) {
+    event_store->append(packet);
+  }
+  if (device == "genn") {
+    auto genn_events = genn_slot.begin_write();
+    for (size_t i = 0; i < packet.size(); i++) {
+      const AER::Event event = packet[i];
+      set_genn_event(*genn_events, event.x, event.y, event.polarity);
     }
+    genn_slot.end_write();
+  } else {
+    (this->*timed_kernel)(buffer_slot.begin_write(), packet);
+    buffer_slot.end_write();
+  }
+  if (!packet.empty()) {
+    notify_received(packet.size(), packet.back().timestamp);
   }
 }
 
-template <typename R>
-inline void TensorBuffer::assign_event(R *array, int16_t x, int16_t y) {
-  (*(array + shape[1] * x + y))++;
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::start_window(uint64_t timestamp) {
+  if (device == "genn") {
+    return;
+  }
+  PooledBuffer *frame = buffer_slot.begin_write();
+  frame->window_start = frame->window_start.value_or(timestamp);
+  buffer_slot.end_write();
 }
 
-std::unique_ptr<BufferPointer> TensorBuffer::read() {
-  // Swap out old pointer
-  {
-    const std::lock_guard lock{buffer_lock};
-    buffer1.swap(buffer2);
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::accumulate(void *frame,
+                                        const std::vector<AER::Event> &events,
+                                        uint64_t window_start) {
+  if (device == "genn") {
+    throw std::invalid_argument("Frames cannot be accumulated with GeNN");
   }
-  // Create new buffer and swap with old
-  buffer_t buffer3 = allocate_buffer<float>(shape[0] * shape[1], device);
+  PooledBuffer target{frame, nullptr, window_start};
+  (this->*vector_kernel)(&target, events);
+  if (options.mode == FrameMode::Surface) {
+    if (!events.empty()) {
+      arrivals->current_timestamp.store(events.back().timestamp);
+    }
+    read_surface(static_cast<scalar_t *>(frame));
+  }
+}
+
+template <typename scalar_t>
+size_t TensorBuffer<scalar_t>::frame_bytes() const {
+  size_t length = 1;
+  for (auto size : frame_shape) {
+    length *= size;
+  }
+  return length * sizeof(scalar_t);
+}
+
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::merge(void *frame, const void *other) const {
+  scalar_t *array = static_cast<scalar_t *>(frame);
+  const scalar_t *source = static_cast<const scalar_t *>(other);
+  const size_t length = frame_bytes() / sizeof(scalar_t);
+  if (std::is_same_v<scalar_t, bool> || options.mode == FrameMode::Binary ||
+      options.mode == FrameMode::Surface) {
+    // Marks and decayed times keep the larger value
+    for (size_t i = 0; i < length; i++) {
+      array[i] = std::max(array[i], source[i]);
+    }
+  } else if (options.pooling == Pooling::Any) {
+    for (size_t i = 0; i < length; i++) {
+      array[i] = source[i] != 0 ? source[i] : array[i];
+    }
+  } else {
+    for (size_t i = 0; i < length; i++) {
+      add_value(array[i], static_cast<float>(source[i]));
+    }
+  }
+}
 
-  buffer2.swap(buffer3);
+template <typename scalar_t>
+std::unique_ptr<BufferPointer> TensorBuffer<scalar_t>::read() {
+  const std::lock_guard lock{read_lock};
+  if (options.mode == FrameMode::Surface) {
+    // The surface overwrites every element of the frame
+    PooledBuffer *buffer = pool->acquire_for_overwrite();
+    mark_read();
+    read_surface(static_cast<scalar_t *>(buffer->data));
+    return std::unique_ptr<BufferPointer>(
+        new BufferPointer(buffer, frame_shape, device, nb::dtype<scalar_t>()));
+  }
+  // Swap a recycled, zeroed buffer in for the accumulated one
+  PooledBuffer *buffer = buffer_slot.exchange(pool->acquire());
+  mark_read();
   // Return pointer
   return std::unique_ptr<BufferPointer>(
-      new BufferPointer(std::move(buffer3), shape, device));
+      new BufferPointer(buffer, frame_shape, device, nb::dtype<scalar_t>()));
 }
 
-void TensorBuffer::read_genn(uint32_t *bitmask, size_t size) {
-  // Check size
-  assert(size == genn_events.size());
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::read_surface(scalar_t *array) {
+  // Decay the last event time at each pixel in blocks: copy the times out of
+  // the shared map, then compute the surface in a loop the compiler can
+  // vectorize
+  constexpr size_t BLOCK_SIZE = 1024;
+  uint64_t times[BLOCK_SIZE];
+  float values[BLOCK_SIZE];
+  const uint64_t now = arrivals->current_timestamp.load();
+  const float rate = -1.0f / options.tau_us;
+  for (size_t begin = 0; begin < plane_size; begin += BLOCK_SIZE) {
+    const size_t length = std::min(BLOCK_SIZE, plane_size - begin);
+    for (size_t i = 0; i < length; i++) {
+      times[i] = last_timestamps[begin + i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < length; i++) {
+      // Events newer than now, raced in during the copy, count as fresh
+      const int64_t age = static_cast<int64_t>(now - times[i]);
+      const float decay = std::exp(std::max<int64_t>(age, 0) * rate);
+      values[i] = times[i] == NO_EVENT ? 0.0f : decay;
+    }
+#ifdef USE_CUDA
+    if (device == "cuda") {
+      copy_memory_cuda(array + begin, values, length * sizeof(float));
+      continue;
+    }
+#endif
+    std::copy(values, values + length, array + begin);
+  }
+}
 
-  // Lock
-  // **THINK** we COULD double-buffer but I suspect not worth it
-  std::lock_guard lock{buffer_lock};
+template <typename scalar_t>
+void TensorBuffer<scalar_t>::read_genn(uint32_t *bitmask, size_t size) {
+  const std::lock_guard lock{read_lock};
+  // Swap the zeroed spare bitmask in for the accumulated one
+  std::vector<uint32_t> *genn_events = genn_slot.exchange(genn_spare);
+  mark_read();
+
+  // Check size
+  assert(size == genn_events->size());
 
   // Copy bitmask to GeNN-owned pointer
-  std::copy(genn_events.cbegin(), genn_events.cend(), bitmask);
+  std::copy(genn_events->cbegin(), genn_events->cend(), bitmask);
+
+  // Zero bitmask, which becomes the next spare
+  std::fill(genn_events->begin(), genn_events->end(), 0);
+  genn_spare = genn_events;
+}
 
-  // Zero bitmask
-  std::fill(genn_events.begin(), genn_events.end(), 0);
+template class TensorBuffer<float>;
+template class TensorBuffer<uint8_t>;
+template class TensorBuffer<uint16_t>;
+template class TensorBuffer<int16_t>;
+template class TensorBuffer<bool>;
+
+std::unique_ptr<BufferPointer>
+read_merged(const std::vector<std::unique_ptr<TensorBufferBase>> &shards) {
+  auto frame = shards[0]->read();
+  for (size_t i = 1; i < shards.size(); i++) {
+    const auto other = shards[i]->read();
+    shards[0]->merge(frame->frame(), other->frame());
+  }
+  return frame;
 }
 
-#include <iostream>
+std::unique_ptr<TensorBufferBase>
+make_tensor_buffer(std::vector<size_t> size, std::string device,
+                   size_t buffer_size, const FrameOptions &options) {
+  switch (options.dtype) {
+  case DType::Float32:
+    return std::make_unique<TensorBuffer<float>>(size, device, buffer_size,
+                                                 options);
+  case DType::UInt8:
+    return std::make_unique<TensorBuffer<uint8_t>>(size, device, buffer_size,
+                                                   options);
+  case DType::UInt16:
+    return std::make_unique<TensorBuffer<uint16_t>>(size, device,
+                                                    buffer_size, options);
+  case DType::Int16:
+    return std::make_unique<TensorBuffer<int16_t>>(size, device, buffer_size,
+                                                   options);
+  case DType::Bool:
+    return std::make_unique<TensorBuffer<bool>>(size, device, buffer_size,
+                                                options);
+  default:
+    throw std::invalid_argument("Unknown frame dtype");
+  }
+}
 
-BufferPointer::BufferPointer(buffer_t &&data, const std::vector<size_t> &shape,
-                             const std::string &device)
-    : data(std::move(data)), shape(shape), device(device) {}
+void PooledBuffer::release() noexcept {
+  // Keep the pool alive until the buffer is back, even if this was the last
+  // reference to it
+  const auto owner = std::move(pool);
+  owner->recycle(this);
+}
 
-template <typename tensor_type>
-inline tensor_type BufferPointer::to_tensor_type() {
-  const size_t s[2] = {shape[0], shape[1]};
-  float *ptr = data.release();
-  int32_t device_type =
-      device == "cuda" ? nb::device::cuda::value : nb::device::cpu::value;
-  nb::capsule owner;
-  #ifdef USE_CUDA
+BufferPool::BufferPool(size_t bytes, const std::string &device)
+    : bytes(bytes), device(device) {}
+
+PooledBuffer *BufferPool::acquire() { return take(true); }
+
+PooledBuffer *BufferPool::acquire_for_overwrite() { return take(false); }
+
+PooledBuffer *BufferPool::take(bool clear) {
+  PooledBuffer *buffer = nullptr;
+  {
+    const std::lock_guard lock{pool_lock};
+    if (free_buffers.empty()) { // Buffers from allocate_buffer are zeroed
+      storage.push_back(allocate_buffer<uint8_t>(bytes, device));
+      buffers.push_back(std::unique_ptr<PooledBuffer>(
+          new PooledBuffer{storage.back().get(), nullptr}));
+      buffers.back()->pool = shared_from_this();
+      return buffers.back().get();
+    }
+    buffer = free_buffers.back();
+    free_buffers.pop_back();
+  }
+  // Clear recycled buffers outside the lock
+  if (clear) {
+#ifdef USE_CUDA
     if (device == "cuda") {
-      owner = nb::capsule(ptr, [](void *p) noexcept { free_memory_cuda((float *)p); });
+      clear_memory_cuda(buffer->data, bytes);
     } else {
-  #endif
-      owner = nb::capsule(ptr, [](void *p) noexcept { delete[] (float *) p; });
-  #ifdef USE_CUDA
+#endif
+      std::memset(buffer->data, 0, bytes);
+#ifdef USE_CUDA
     }
-  #endif
-  return tensor_type(ptr, 2, s, owner, /* owner */
-                     nullptr,          /* strides */
-                     nanobind::dtype<float>(), device_type);
+#endif
+  }
+  buffer->window_start.reset();
+  buffer->pool = shared_from_this();
+  return buffer;
 }
 
+void BufferPool::recycle(PooledBuffer *buffer) {
+  const std::lock_guard lock{pool_lock};
+  free_buffers.push_back(buffer);
+}
+
+BufferPointer::BufferPointer(PooledBuffer *data,
+                             const std::vector<size_t> &shape,
+                             const std::string &device,
+                             nb::dlpack::dtype dtype)
+    : data(data), shape(shape), device(device), dtype(dtype) {}
+
+BufferPointer::~BufferPointer() {
+  if (data) { // Never handed to Python
+    data->release();
+  }
+}
+
+template <typename tensor_type>
+inline tensor_type BufferPointer::to_tensor_type() {
+  PooledBuffer *buffer = std::exchange(data, nullptr);
+  int32_t device_type =
+      device == "cuda" ? nb::device::cuda::value : nb::device::cpu::value;
+  // Return the buffer to its pool once Python frees the array
+  nb::capsule owner(buffer, [](void *p) noexcept {
+    static_cast<PooledBuffer *>(p)->release();
+  });
+  return tensor_type(buffer->data, shape.size(), shape.data(), owner,
+                     nullptr, /* strides */
+                     dtype, device_type);
+}
 tensor_numpy BufferPointer::to_numpy() {
   return to_tensor_type<tensor_numpy>();
 }
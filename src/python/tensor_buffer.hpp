@@ -1,11 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "../cpp/aer.hpp"
+#include "../cpp/region.hpp"
+#include "buffer_slot.hpp"
+#include "event_store.hpp"
 #include "types.hpp"
 
 #include <nanobind/nanobind.h>
@@ -13,9 +21,13 @@
 #include <nanobind/stl/unique_ptr.h>
 
 #ifdef USE_CUDA
-void index_increment_cuda(float *array, int *offset_pointer, size_t indices,
-                          int *event_device_pointer);
+void index_add_cuda(float *array, int *offset_pointer, float *value_pointer,
+                    size_t indices, int *offset_device_pointer,
+                    float *value_device_pointer, bool assign);
 void *alloc_memory_cuda(size_t buffer_size, size_t bytes);
+void clear_memory_cuda(void *cuda_device_pointer, size_t bytes);
+void copy_memory_cuda(void *cuda_device_pointer, const void *host_pointer,
+                      size_t bytes);
 void free_memory_cuda(void *cuda_device_pointer);
 template <typename scalar_t> void delete_cuda_buffer(scalar_t *ptr) {
   free_memory_cuda((void *)ptr);
@@ -25,44 +37,276 @@ template <typename scalar_t> void delete_cpu_buffer(scalar_t *ptr) {
   delete[] ptr;
 }
 
-using tensor_jax = nb::ndarray<nb::jax, float, nb::shape<-1>>;
-using tensor_numpy = nb::ndarray<nb::numpy, float, nb::shape<-1>>;
-using tensor_torch = nb::ndarray<nb::pytorch, float, nb::shape<-1>>;
+using tensor_jax = nb::ndarray<nb::jax>;
+using tensor_numpy = nb::ndarray<nb::numpy>;
+using tensor_torch = nb::ndarray<nb::pytorch>;
 using buffer_t = std::unique_ptr<float[], void (*)(float *)>;
+using storage_t = std::unique_ptr<uint8_t[], void (*)(uint8_t *)>;
 using index_t = std::unique_ptr<int[], void (*)(int *)>;
 
+class BufferPool;
+
+/**
+ * A frame buffer owned by a BufferPool. While the buffer is lent out it keeps
+ * the pool alive, so arrays handed to Python may outlive their input.
+ */
+struct PooledBuffer {
+  void *data;
+  std::shared_ptr<BufferPool> pool;
+  // Event time the frame starts at, for modes windowed by event time
+  std::optional<uint64_t> window_start;
+
+  /// Returns the buffer to its pool
+  void release() noexcept;
+};
+
+/**
+ * Recycles frame buffers once they are released, for instance when Python
+ * frees the array that wraps them. Buffers are cleared when they are handed
+ * out again, so steady-state reads make no allocations.
+ */
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+public:
+  BufferPool(size_t bytes, const std::string &device);
+
+  /// Lends out a zeroed buffer, allocating one only if none are free
+  PooledBuffer *acquire();
+  /// Lends out a buffer without clearing it, for callers that overwrite all
+  /// of it
+  PooledBuffer *acquire_for_overwrite();
+
+private:
+  friend struct PooledBuffer;
+  const size_t bytes;
+  const std::string device;
+
+  std::mutex pool_lock;
+  std::vector<storage_t> storage;
+  std::vector<std::unique_ptr<PooledBuffer>> buffers;
+  std::vector<PooledBuffer *> free_buffers;
+
+  PooledBuffer *take(bool clear);
+  void recycle(PooledBuffer *buffer);
+};
+
+/**
+ * A frame read from a TensorBuffer, waiting to be handed to Python. The
+ * element type is carried at runtime so every dtype shares one Python class.
+ */
 struct BufferPointer {
-  BufferPointer(buffer_t &&data, const std::vector<size_t> &shape,
-                const std::string &device);
+  BufferPointer(PooledBuffer *data, const std::vector<size_t> &shape,
+                const std::string &device, nb::dlpack::dtype dtype);
+  ~BufferPointer();
   tensor_numpy to_numpy();
   tensor_jax to_jax();
   tensor_torch to_torch();
+  /// The frame memory, while the frame has not been handed to Python
+  void *frame() const { return data->data; }
   const std::string &device;
 
 private:
   const std::vector<size_t> &shape;
+  const nb::dlpack::dtype dtype;
   template <typename tensor_type> tensor_type to_tensor_type();
-  buffer_t data;
+  PooledBuffer *data;
+};
+
+/**
+ * Options for how a TensorBuffer accumulates events into frames.
+ */
+struct FrameOptions {
+  /// Count events per pixel, count them per polarity in a (2, W, H) frame,
+  /// sum them as +1/-1 by polarity, mark pixels that saw any event, spread
+  /// them over a (bins, 2, W, H) voxel grid by event time, or decay the time
+  /// of the last event at each pixel into a time surface
+  FrameMode mode = FrameMode::Count;
+  /// Element type of the frames. Integer frames saturate instead of wrapping
+  /// around, and boolean frames mark pixels that saw any event.
+  DType dtype = DType::Float32;
+  /// Number of time bins in voxel mode
+  size_t bins = 1;
+  /// Event time spanned by the bins of a voxel frame, in microseconds
+  uint64_t window_us = 0;
+  /// Decay time constant of time surfaces, in microseconds
+  float tau_us = 0;
+  /// Whether to keep the received events for read_events and read_sparse
+  bool record_events = false;
+  /// Order of the spatial dimensions of frames: x-major (W, H) or row-major
+  /// (H, W), after flips and rotation
+  Layout layout = Layout::WH;
+  /// Whether polarity channels come after the spatial dimensions, as in
+  /// (W, H, 2), rather than before them
+  bool channels_last = false;
+  /// Mirror the x or y coordinates of events
+  bool flip_x = false;
+  bool flip_y = false;
+  /// Clockwise rotation in degrees, in steps of 90, with y pointing down
+  int rotation = 0;
+  /// Region of the sensor to keep, as its corner and size in pixels. A zero
+  /// width or height reaches to the edge of the sensor.
+  size_t roi_x = 0;
+  size_t roi_y = 0;
+  size_t roi_width = 0;
+  size_t roi_height = 0;
+  /// Integer factor that both spatial dimensions of the region shrink by
+  size_t downsample = 1;
+  /// Whether downsampled pixels sum the events of their block or mark that
+  /// any arrived, in count, polarity and signed modes
+  Pooling pooling = Pooling::Sum;
+};
+
+/**
+ * Maps event coordinates to the offset of their pixel in a frame plane.
+ * Cropping and downsampling are looked up per column and row, and the flips,
+ * rotation and layout of the frame options fold into one affine map, so they
+ * cost nothing extra during accumulation.
+ */
+struct PixelMap {
+  static constexpr uint16_t OUTSIDE = UINT16_MAX;
+  int64_t origin = 0;
+  int64_t x_stride = 0;
+  int64_t y_stride = 1;
+  // Downsampled column and row of each sensor column and row, or OUTSIDE
+  std::vector<uint16_t> columns;
+  std::vector<uint16_t> rows;
+
+  PixelMap() = default;
+  PixelMap(const std::vector<size_t> &size, const Region &region,
+           const FrameOptions &options);
+
+  /// Whether an event falls within the sensor and the region of interest
+  bool contains(uint16_t x, uint16_t y) const {
+    return x < columns.size() && y < rows.size() && columns[x] != OUTSIDE &&
+           rows[y] != OUTSIDE;
+  }
+  /// Offset of an event the map contains
+  size_t operator()(uint16_t x, uint16_t y) const {
+    return origin + columns[x] * x_stride + rows[y] * y_stride;
+  }
+};
+
+/**
+ * Counts the events that arrived at a buffer, so readers can wait for them
+ * without polling. Buffers that shard one input share their arrivals.
+ */
+struct Arrivals {
+  // Time of the latest event, which time surfaces decay towards
+  std::atomic<uint64_t> current_timestamp = 0;
+  std::atomic<uint64_t> received_events = 0;
+  std::atomic<uint64_t> frame_start = 0;
+  std::atomic<bool> finished = false;
+  std::atomic<int> waiters = 0;
+  std::mutex wait_lock;
+  std::condition_variable frame_ready;
 };
 
-class TensorBuffer {
+/**
+ * The part of a TensorBuffer that does not depend on its element type, so
+ * inputs can pick the frame dtype at runtime.
+ */
+class TensorBufferBase {
+public:
+  TensorBufferBase(std::vector<size_t> size, const FrameOptions &options);
+  virtual ~TensorBufferBase() = default;
+  const std::vector<size_t> shape;
+  const FrameOptions options;
+  // Part of the sensor accumulated into frames
+  const Region region;
+  // Shape of the frames handed out by read, which depends on the mode
+  const std::vector<size_t> frame_shape;
+  const size_t plane_size;
+  // Offsets of pixels within a plane, and of polarity channels within frames
+  const PixelMap pixels;
+  const size_t pixel_stride;
+  const size_t channel_stride;
+
+  virtual void set_buffer(uint16_t data[], int numbytes) = 0;
+  virtual void set_vector(std::vector<AER::Event> &events) = 0;
+  /// Accumulates events where they lie, such as in memory shared with
+  /// another process
+  virtual void set_events(std::span<const AER::Event> events) = 0;
+  /// Accumulates the events of a timestamped UDP packet where they were
+  /// received, at their own times rather than the time of arrival
+  virtual void set_packet(const TimedPacket &packet) = 0;
+  virtual std::unique_ptr<BufferPointer> read() = 0;
+  virtual void read_genn(uint32_t *bitmask, size_t size) = 0;
+  /// Starts the window of the current voxel frame at the given event time,
+  /// rather than at its first event
+  virtual void start_window(uint64_t timestamp) = 0;
+  /// Accumulates events into a zeroed frame owned by the caller, bypassing
+  /// the buffer read by read(). Time surfaces are computed into the frame
+  /// after the events are added.
+  virtual void accumulate(void *frame, const std::vector<AER::Event> &events,
+                          uint64_t window_start) = 0;
+  /// Size of a frame in bytes
+  virtual size_t frame_bytes() const = 0;
+  virtual nb::dlpack::dtype frame_dtype() const = 0;
+  /// Merges a frame read from another buffer with the same options into one
+  /// read from this buffer, on the CPU
+  virtual void merge(void *frame, const void *other) const = 0;
+  nb::dict read_events();
+  nb::tuple read_sparse();
+
+  /// Blocks until the next frame holds at least min_events events and an
+  /// event at or after until_timestamp arrived, or until the input finished.
+  /// Returns false if the timeout, in seconds, passed first.
+  bool wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+            std::optional<double> timeout);
+  /// Releases waiting readers once the input has no more events
+  void finish();
+  /// Reads the events recorded by buffers that shard one input, merged
+  static nb::dict
+  read_events(const std::vector<std::unique_ptr<TensorBufferBase>> &shards);
+  static nb::tuple
+  read_sparse(const std::vector<std::unique_ptr<TensorBufferBase>> &shards);
+  /// Counts events and waits together with another buffer, before either
+  /// receives events
+  void share_arrivals(const TensorBufferBase &other) {
+    arrivals = other.arrivals;
+  }
+
+protected:
+  // Received events, if they are recorded
+  std::shared_ptr<EventStore> event_store;
+  std::shared_ptr<Arrivals> arrivals = std::make_shared<Arrivals>();
+
+  static std::vector<EventStore *>
+  shard_stores(const std::vector<std::unique_ptr<TensorBufferBase>> &shards);
+  void notify_received(size_t count, uint64_t timestamp);
+  void mark_read() {
+    arrivals->frame_start.store(arrivals->received_events.load());
+  }
+};
+
+template <typename scalar_t> class TensorBuffer : public TensorBufferBase {
 private:
-  uint64_t current_timestamp = 0;
   std::string device;
 
-  std::mutex buffer_lock;
-  buffer_t buffer1 = std::unique_ptr<float[], void (*)(float *)>(
-      new float[1], delete_cpu_buffer<float>);
-  buffer_t buffer2 = std::unique_ptr<float[], void (*)(float *)>(
-      new float[1], delete_cpu_buffer<float>);
+  // Serializes readers; never taken by the producer
+  std::mutex read_lock;
+  std::shared_ptr<BufferPool> pool;
+  BufferSlot<PooledBuffer> buffer_slot;
 #ifdef USE_CUDA
+  // Element updates staged for one kernel launch, at most as many as the
+  // device buffers hold
   std::vector<int> offset_buffer;
+  std::vector<float> value_buffer;
+  size_t staging_capacity = 0;
   index_t cuda_buffer = std::unique_ptr<int[], void (*)(int *)>(
       new int[1], delete_cpu_buffer<int>);
+  buffer_t cuda_values = std::unique_ptr<float[], void (*)(float *)>(
+      new float[1], delete_cpu_buffer<float>);
 #endif
-  std::vector<uint32_t> genn_events;
+  std::vector<uint32_t> genn_events1;
+  std::vector<uint32_t> genn_events2;
+  BufferSlot<std::vector<uint32_t>> genn_slot;
+  std::vector<uint32_t> *genn_spare = nullptr;
 
-  void set_genn_event(int x, int y, bool polarity) {
+  void set_genn_event(std::vector<uint32_t> &genn_events, int x, int y,
+                      bool polarity) {
+    if (!pixels.contains(x, y)) {
+      return;
+    }
     if (shape.size() == 2 || shape[2] == 1) {
       const int idx = x + (y * shape[0]);
       genn_events[idx / 32] |= (1 << (idx % 32));
@@ -73,14 +317,79 @@ private:
     }
   }
 
+  // Accumulation kernels, specialized per mode and selected on construction
+  using vector_kernel_t = void (TensorBuffer::*)(
+      PooledBuffer *, const std::span<const AER::Event> &);
+  using packet_kernel_t = void (TensorBuffer::*)(PooledBuffer *,
+                                                 const uint16_t *, int);
+  using timed_kernel_t = void (TensorBuffer::*)(PooledBuffer *,
+                                               const TimedPacket &);
+  vector_kernel_t vector_kernel;
+  packet_kernel_t packet_kernel;
+  timed_kernel_t timed_kernel;
+
+  // Time of the last event at each pixel, for time surfaces
+  std::unique_ptr<std::atomic<uint64_t>[]> last_timestamps;
+  static constexpr uint64_t NO_EVENT = UINT64_MAX;
+
+  // Voxel bin positions of the current batch
+  std::vector<float> bin_positions;
+  float bin_scale = 0;
+
+  template <FrameMode mode> void select_kernels();
+  template <FrameMode mode, Pooling pooling> void select_device_kernels();
+  template <FrameMode mode>
+  size_t event_offset(uint16_t x, uint16_t y, bool polarity) const;
+  template <FrameMode mode, Pooling pooling, bool on_device>
+  void assign_event(scalar_t *array, uint16_t x, uint16_t y, bool polarity);
+  template <bool on_device>
+  void assign_voxel(scalar_t *array, uint16_t x, uint16_t y, bool polarity,
+                    float position);
+  template <FrameMode mode, Pooling pooling>
+  void stage(scalar_t *array, size_t offset, float value);
+  template <FrameMode mode, Pooling pooling, bool on_device>
+  void flush_events(scalar_t *array);
+  float bin_position(uint64_t window_start, uint64_t timestamp) const;
+  template <bool on_device>
+  uint64_t roll_window(PooledBuffer *frame, uint64_t timestamp);
+  void assign_timestamp(uint16_t x, uint16_t y, uint64_t timestamp);
+  void read_surface(scalar_t *array);
+  // Accumulates any indexable sequence of events, such as vectors or
+  // timestamped packets
+  template <FrameMode mode, Pooling pooling, bool on_device, typename Events>
+  void accumulate_events(PooledBuffer *frame, const Events &events);
+  template <FrameMode mode, Pooling pooling, bool on_device>
+  void accumulate_packet(PooledBuffer *frame, const uint16_t *data,
+                         int length);
+
 public:
   TensorBuffer(std::vector<size_t> size, std::string device,
-               size_t buffer_size);
-  const std::vector<size_t> shape;
+               size_t buffer_size,
+               const FrameOptions &options = FrameOptions());
+  ~TensorBuffer();
 
-  template <typename R> void assign_event(R *array, int16_t x, int16_t y);
-  void set_buffer(uint16_t data[], int numbytes);
-  void set_vector(std::vector<AER::Event> &events);
-  std::unique_ptr<BufferPointer> read();
-  void read_genn(uint32_t *bitmask, size_t size);
+  void set_buffer(uint16_t data[], int numbytes) override;
+  void set_vector(std::vector<AER::Event> &events) override;
+  void set_events(std::span<const AER::Event> events) override;
+  void set_packet(const TimedPacket &packet) override;
+  std::unique_ptr<BufferPointer> read() override;
+  void read_genn(uint32_t *bitmask, size_t size) override;
+  void start_window(uint64_t timestamp) override;
+  void accumulate(void *frame, const std::vector<AER::Event> &events,
+                  uint64_t window_start) override;
+  size_t frame_bytes() const override;
+  nb::dlpack::dtype frame_dtype() const override {
+    return nb::dtype<scalar_t>();
+  }
+  void merge(void *frame, const void *other) const override;
 };
+
+/// Reads the frames of buffers that shard one input, merged into one frame
+std::unique_ptr<BufferPointer>
+read_merged(const std::vector<std::unique_ptr<TensorBufferBase>> &shards);
+
+/// Creates a TensorBuffer with the element type chosen in the options
+std::unique_ptr<TensorBufferBase>
+make_tensor_buffer(std::vector<size_t> size, std::string device,
+                   size_t buffer_size,
+                   const FrameOptions &options = FrameOptions());
@@ -6,24 +6,35 @@
 #include <vector>
 
 template <typename scalar_t>
-__global__ void cuda_increment_kernel(scalar_t *__restrict__ array,
-                                      int *__restrict__ offsets,
-                                      const size_t size) {
-  int index = threadIdx.x; // Pixel offset
+__global__ void cuda_add_kernel(scalar_t *__restrict__ array,
+                                const int *__restrict__ offsets,
+                                const scalar_t *__restrict__ values,
+                                const size_t size, const bool assign) {
+  const size_t index = blockIdx.x * blockDim.x + threadIdx.x; // Event index
   if (index < size) {
-    float val = 1;
-    atomicAdd((array + offsets[index]), val);
+    if (assign) {
+      array[offsets[index]] = values[index];
+    } else {
+      atomicAdd((array + offsets[index]), values[index]);
+    }
   }
 }
 
-void index_increment_cuda(float *array, int *offset_pointer, size_t indices,
-                          int *event_device_pointer) {
-  const size_t buffer_size = indices * sizeof(int);
+void index_add_cuda(float *array, int *offset_pointer, float *value_pointer,
+                    size_t indices, int *offset_device_pointer,
+                    float *value_device_pointer, bool assign) {
+  if (indices == 0) {
+    return;
+  }
+  const int threads = 256;
+  const int blocks = (indices + threads - 1) / threads;
 
-  cudaMemcpyAsync(event_device_pointer, offset_pointer, buffer_size,
+  cudaMemcpyAsync(offset_device_pointer, offset_pointer, indices * sizeof(int),
+                  cudaMemcpyHostToDevice, cudaStreamPerThread);
+  cudaMemcpyAsync(value_device_pointer, value_pointer, indices * sizeof(float),
                   cudaMemcpyHostToDevice, cudaStreamPerThread);
-  cuda_increment_kernel<float>
-      <<<1, indices>>>(array, event_device_pointer, indices);
+  cuda_add_kernel<float><<<blocks, threads, 0, cudaStreamPerThread>>>(
+      array, offset_device_pointer, value_device_pointer, indices, assign);
 }
 
 void *alloc_memory_cuda(size_t buffer_size, size_t bytes) {
@@ -46,6 +57,26 @@ void *alloc_memory_cuda(size_t buffer_size, size_t bytes) {
   return cuda_device_pointer;
 }
 
+void clear_memory_cuda(void *cuda_device_pointer, size_t bytes) {
+  cudaError_t err = cudaMemsetAsync(cuda_device_pointer, 0, bytes, 0);
+  if (err != cudaSuccess) {
+    std::stringstream ss;
+    ss << "Error when resetting memory on GPU: " << cudaGetErrorString(err);
+    throw std::runtime_error(ss.str());
+  }
+}
+
+void copy_memory_cuda(void *cuda_device_pointer, const void *host_pointer,
+                      size_t bytes) {
+  cudaError_t err = cudaMemcpy(cuda_device_pointer, host_pointer, bytes,
+                               cudaMemcpyHostToDevice);
+  if (err != cudaSuccess) {
+    std::stringstream ss;
+    ss << "Error when copying memory to GPU: " << cudaGetErrorString(err);
+    throw std::runtime_error(ss.str());
+  }
+}
+
 void free_memory_cuda(void *cuda_device_pointer) {
   cudaError_t err = cudaFree(cuda_device_pointer);
   if (err != cudaSuccess) {
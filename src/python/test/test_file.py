@@ -22,6 +22,38 @@ def test_load_aedat4():
     assert buf[0]["polarity"] == True
 
 
+def test_read_into_dat():
+    from aestream._input import NUMPY_EVENT_DTYPE
+
+    f = FileInput("example/sample.dat", shape=(600, 400))
+    events = np.empty(1000, dtype=NUMPY_EVENT_DTYPE)
+    assert f.read_into(events) == 1000
+    assert events[0]["x"] == 237
+    assert events[0]["y"] == 121
+
+    timestamp = np.empty(539481, dtype=np.int64)
+    x = np.empty(539481, dtype=np.int16)
+    y = np.empty(539481, dtype=np.int16)
+    polarity = np.empty(539481, dtype=np.bool_)
+    assert f.read_columns_into(timestamp, x, y, polarity) == 539481 - 1000
+    # Arrays of other dtypes are rejected rather than reinterpreted
+    with pytest.raises(TypeError):
+        f.read_columns_into(timestamp, x.astype(np.int32), y, polarity)
+    with pytest.raises(TypeError):
+        f.read_columns_into(timestamp, x, y, polarity.astype(np.float64))
+    with pytest.raises(TypeError):
+        f.read_into(np.empty(1000, dtype=np.int64))
+
+
+def test_load_dat_rest():
+    from aestream._input import NUMPY_EVENT_DTYPE
+
+    f = FileInput("example/sample.dat", shape=(600, 400))
+    f.read_into(np.empty(1000, dtype=NUMPY_EVENT_DTYPE))
+    # Loading continues after the events read, in an array of what is left
+    assert len(f.load()) == 539481 - 1000
+
+
 def test_stream_aedat4():
     with FileInput(
         filename="example/sample.aedat4", shape=(346, 260), ignore_time=True
@@ -79,6 +111,115 @@ def test_stream_dat():
     assert events == 539481
 
 
+def test_stream_dat_uint16():
+    with FileInput(
+        filename="example/sample.dat",
+        shape=(600, 400),
+        ignore_time=True,
+        dtype=np.uint16,
+    ) as stream:
+        time.sleep(0.3)
+        interval = 0.5
+        t_0 = time.time()
+        events = 0
+        while time.time() < t_0 + interval:
+            frame = stream.read()
+            assert frame.dtype == np.uint16
+            events += frame.sum()
+        events += stream.read().sum()
+    assert events == 539481
+
+
+def test_stream_dat_voxel():
+    with FileInput(
+        filename="example/sample.dat",
+        shape=(600, 400),
+        ignore_time=True,
+        mode="voxel",
+        bins=4,
+        window_us=10000,
+    ) as stream:
+        time.sleep(0.3)
+        interval = 0.5
+        t_0 = time.time()
+        events = 0
+        while time.time() < t_0 + interval:
+            frame = stream.read()
+            assert frame.shape == (4, 2, 600, 400)
+            events += frame.sum(dtype=np.float64)
+        events += stream.read().sum(dtype=np.float64)
+    # Every event is split into weights that sum to one, and the windows that
+    # were not read in time are dropped
+    assert 0 < events < 539481 * 1.001
+
+
+def test_stream_csv_voxel_windows(tmp_path):
+    filename = tmp_path / "events.csv"
+    # Three events in the first window and two in the third
+    filename.write_text("0,1,1,1\n500,1,1,1\n999,1,1,1\n2500,1,1,1\n2600,1,1,1\n")
+    with FileInput(
+        filename=str(filename),
+        shape=(4, 4),
+        ignore_time=True,
+        mode="voxel",
+        bins=2,
+        window_us=1000,
+    ) as stream:
+        stream.wait(min_events=5)
+        frame = stream.read()
+    # The frame moved on to the window from 2000 to 3000 rather than piling
+    # the later events into the last bin of the first window
+    assert frame.sum() == pytest.approx(2)
+    assert frame[0, 1, 1, 1] == pytest.approx(0.9)
+    assert frame[1, 1, 1, 1] == pytest.approx(1.1)
+
+
+def test_frames_dat():
+    f = FileInput("example/sample.dat", shape=(600, 400))
+    events = f.load()
+    f = FileInput("example/sample.dat", shape=(600, 400))
+    frames = list(f.frames(window_us=100000))
+    duration = int(events["timestamp"][-1] - events["timestamp"][0])
+    assert len(frames) == duration // 100000 + 1
+    assert sum(frame.sum() for frame in frames) == len(events)
+    # Frames are cut by event time, and so do not depend on the reader
+    first = events["timestamp"] < events["timestamp"][0] + 100000
+    assert frames[0].sum() == first.sum()
+
+
+def test_frames_dat_sliding():
+    f = FileInput("example/sample.dat", shape=(600, 400))
+    windows = list(f.frames(window_us=100000))
+    f = FileInput("example/sample.dat", shape=(600, 400))
+    sliding = list(f.frames(window_us=100000, stride_us=50000))
+    # Every other sliding frame matches a frame without overlap
+    for i, frame in enumerate(windows):
+        assert np.array_equal(sliding[2 * i], frame)
+
+
+def test_frames_dat_repeated():
+    f = FileInput("example/sample.dat", shape=(600, 400))
+    events = f.load()
+    # Every iteration reads the whole file, even after load or another one
+    first = list(f.frames(window_us=100000))
+    second = list(f.frames(window_us=100000))
+    assert sum(frame.sum() for frame in first) == len(events)
+    assert len(first) == len(second)
+    for a, b in zip(first, second):
+        assert np.array_equal(a, b)
+    batches = list(f.frames_batched(window_us=100000, batch=4))
+    assert np.array_equal(np.concatenate(batches), np.stack(first))
+
+
+def test_frames_batched_dat():
+    f = FileInput("example/sample.dat", shape=(600, 400), mode="polarity")
+    frames = list(f.frames(window_us=100000))
+    f = FileInput("example/sample.dat", shape=(600, 400), mode="polarity")
+    batches = list(f.frames_batched(window_us=100000, batch=4))
+    assert batches[0].shape == (4, 2, 600, 400)
+    assert np.array_equal(np.concatenate(batches), np.stack(frames))
+
+
 @pytest.mark.skipif(not _has_cuda_torch(), reason="Torch-gpu is not installed")
 def test_stream_dat_torch_cuda():
     import torch
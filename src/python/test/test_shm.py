@@ -0,0 +1,92 @@
+import mmap
+import os
+import struct
+import time
+
+from aestream import SharedMemoryInput
+
+# Offsets in the header of a ring, as laid out by src/cpp/shm_ring.hpp
+HEADER_BYTES = 576
+PUBLISHED = 64
+CLOSED = 72
+PRODUCER = 76
+FIRST_CONSUMER = 192
+
+
+class Ring:
+    """Writes batches to a ring like `aestream ... output shm` does"""
+
+    def __init__(self, name, slots=4, slot_events=16):
+        self.path = "/dev/shm/" + name
+        self.slots = slots
+        self.slot_bytes = (16 + 13 * slot_events + 63) // 64 * 64
+        size = HEADER_BYTES + slots * self.slot_bytes
+        fd = os.open(self.path, os.O_CREAT | os.O_RDWR, 0o600)
+        os.ftruncate(fd, size)
+        self.memory = mmap.mmap(fd, size)
+        os.close(fd)
+        struct.pack_into("<IIIQ", self.memory, 4, 1, slots, slot_events, self.slot_bytes)
+        struct.pack_into("<i", self.memory, PRODUCER, os.getpid())
+        struct.pack_into("<I", self.memory, 0, 0xAE575348)
+        self.batches = 0
+
+    def wait_for_consumer(self, timeout=5.0):
+        deadline = time.time() + timeout
+        while struct.unpack_from("<i", self.memory, FIRST_CONSUMER)[0] == 0:
+            assert time.time() < deadline
+            time.sleep(0.01)
+
+    def publish(self, events, announce=True):
+        offset = HEADER_BYTES + (self.batches % self.slots) * self.slot_bytes
+        payload = b"".join(struct.pack("<QHH?", *event) for event in events)
+        self.memory[offset + 16 : offset + 16 + len(payload)] = payload
+        struct.pack_into("<QI", self.memory, offset, 2 * self.batches + 2, len(events))
+        self.batches += 1
+        if announce:
+            struct.pack_into("<Q", self.memory, PUBLISHED, self.batches)
+
+    def close(self):
+        struct.pack_into("<I", self.memory, CLOSED, 1)
+        self.memory.close()
+        os.unlink(self.path)
+
+
+def test_shm():
+    ring = Ring("aestream_test_shm")
+    try:
+        with SharedMemoryInput(
+            (640, 480), name="aestream_test_shm", record_events=True
+        ) as stream:
+            ring.wait_for_consumer()
+            ring.publish([(1000, 218, 15, True), (1005, 3, 4, False)])
+
+            stream.wait(min_events=2, timeout=5.0)
+            events = stream.read_events()
+            stats = stream.receive_stats()
+    finally:
+        ring.close()
+    assert list(events["timestamp"]) == [1000, 1005]
+    assert list(events["x"]) == [218, 3]
+    assert list(events["y"]) == [15, 4]
+    assert list(events["polarity"]) == [True, False]
+    assert stats.batches == 1
+    assert stats.lost_batches == 0
+
+
+def test_shm_slow_consumer():
+    ring = Ring("aestream_test_shm_slow")
+    try:
+        with SharedMemoryInput((640, 480), name="aestream_test_shm_slow") as stream:
+            ring.wait_for_consumer()
+            # Ten batches arrive at once, but the ring holds four, and readers
+            # stay a slot clear of the producer
+            for batch in range(10):
+                ring.publish([(batch, 218, 15, True)], announce=batch == 9)
+
+            frame = stream.read(min_events=3, timeout=5.0)
+            stats = stream.receive_stats()
+    finally:
+        ring.close()
+    assert stats.batches == 3
+    assert stats.lost_batches == 7
+    assert frame[218, 15] == 3
@@ -0,0 +1,42 @@
+import socket
+import struct
+
+from aestream import TCPInput
+
+
+def frame(events):
+    header = struct.pack("<II", 0xAE57F4A3, len(events))
+    return header + b"".join(struct.pack("<QHH?", *event) for event in events)
+
+
+def send_frames(family, address, data):
+    sock = socket.socket(family, socket.SOCK_STREAM)
+    sock.connect(address)
+    sock.sendall(data)
+    sock.close()
+
+
+def test_tcp():
+    events = [(1000, 218, 15, True), (1005, 218, 15, False), (1010, 3, 4, True)]
+    with TCPInput((640, 480), port=33347, record_events=True) as stream:
+        send_frames(socket.AF_INET, ("127.0.0.1", 33347), frame(events[:2]))
+        send_frames(socket.AF_INET, ("127.0.0.1", 33347), frame(events[2:]))
+
+        stream.wait(min_events=3, timeout=5.0)
+        received = stream.read_events()
+        stats = stream.receive_stats()
+    assert list(received["timestamp"]) == [1000, 1005, 1010]
+    assert list(received["x"]) == [218, 218, 3]
+    assert list(received["y"]) == [15, 15, 4]
+    assert list(received["polarity"]) == [True, False, True]
+    assert stats.connections == 2
+    assert stats.frames == 2
+
+
+def test_unix_socket(tmp_path):
+    path = str(tmp_path / "events.sock")
+    with TCPInput((640, 480), path=path) as stream:
+        send_frames(socket.AF_UNIX, path, frame([(1000, 218, 15, True)]))
+
+        result = stream.read(min_events=1, timeout=5.0)
+    assert result[218, 15] == 1
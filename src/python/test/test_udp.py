@@ -1,5 +1,6 @@
 import multiprocessing
 import socket
+import struct
 import time
 import pytest
 
@@ -9,15 +10,16 @@ from aestream import UDPInput
 from . import _has_cuda_torch
 
 
-def stream_fake_data(port):
-    data = b"\x0F\x00\xDA\x00"
+def stream_fake_data(port, data, host):
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    sock.sendto(data, ("127.0.0.1", port))
+    sock.sendto(data, (host, port))
     sock.close()
 
 
-def start_stream(port):
-    p = multiprocessing.Process(target=stream_fake_data, args=(port,))
+def start_stream(port, data=b"\x0F\x00\xDA\x00", host="127.0.0.1"):
+    p = multiprocessing.Process(
+        target=stream_fake_data, args=(port, data, host)
+    )
     p.start()
     return p
 
@@ -35,6 +37,182 @@ def test_udp():
     assert numpy.equal(frame[218, 15], 1)
 
 
+def test_udp_polarity():
+    # Two events at (218, 15): one positive, one negative
+    data = b"\x0F\x80\xDA\x00\x0F\x00\xDA\x00"
+    with UDPInput((640, 480), device="cpu", port=33335, mode="polarity") as stream:
+        start_stream(33335, data)
+
+        time.sleep(0.5)
+        frame = stream.read()
+    assert frame.shape == (2, 640, 480)
+    assert numpy.equal(frame[0, 218, 15], 1)
+    assert numpy.equal(frame[1, 218, 15], 1)
+    assert frame.sum() == 2
+
+
+def test_udp_surface():
+    with UDPInput(
+        (640, 480), device="cpu", port=33336, mode="surface", tau_us=1000
+    ) as stream:
+        start_stream(33336)
+
+        time.sleep(0.5)
+        frame = stream.read()
+        # Surfaces persist across reads
+        again = stream.read()
+    assert numpy.equal(frame[218, 15], 1)
+    assert numpy.equal(again[218, 15], 1)
+    assert frame.sum() == 1
+
+
+def test_udp_read_events():
+    with UDPInput((640, 480), port=33337, record_events=True) as stream:
+        start_stream(33337, b"\x0F\x80\xDA\x00")
+
+        time.sleep(0.5)
+        events = stream.read_events()
+        indices, values = stream.read_sparse()
+    assert list(events["x"]) == [218]
+    assert list(events["y"]) == [15]
+    assert list(events["polarity"]) == [True]
+    # Events are only returned once
+    assert indices.shape == (2, 0)
+    assert len(values) == 0
+
+
+def test_udp_layout():
+    with UDPInput(
+        (640, 480), port=33340, mode="polarity", layout="hw", channels_last=True
+    ) as stream:
+        start_stream(33340)
+
+        frame = stream.read(min_events=1, timeout=5.0)
+    assert frame.shape == (480, 640, 2)
+    assert numpy.equal(frame[15, 218, 0], 1)
+
+
+def test_udp_roi_downsample():
+    with UDPInput(
+        (640, 480), port=33341, roi=(200, 0, 100, 100), downsample=4
+    ) as stream:
+        start_stream(33341)
+
+        frame = stream.read(min_events=1, timeout=5.0)
+    assert frame.shape == (25, 25)
+    assert numpy.equal(frame[4, 3], 1)
+    assert frame.sum() == 1
+
+
+def test_udp_threads():
+    with UDPInput((640, 480), port=33342, threads=2) as stream:
+        start_stream(33342)
+
+        frame = stream.read(min_events=1, timeout=5.0)
+        stats = stream.receive_stats()
+    assert numpy.equal(frame[218, 15], 1)
+    assert stats.packets == 1
+    assert stats.events == 1
+    assert stats.dropped_packets == 0
+
+
+def test_udp_threads_record_events():
+    with UDPInput((640, 480), port=33348, threads=2, record_events=True) as stream:
+        # Each sender has its own source port, which the kernel hashes to one
+        # of the sockets
+        for _ in range(8):
+            start_stream(33348)
+
+        assert stream.wait(min_events=8, timeout=5.0)
+        events = stream.read_events()
+    assert len(events["timestamp"]) == 8
+    assert list(events["x"]) == [218] * 8
+    assert list(events["y"]) == [15] * 8
+
+
+def test_udp_failed_start_releases_port():
+    stream = UDPInput((640, 480), port=33349, multicast_groups=["10.0.0.1"])
+    with pytest.raises(ValueError):
+        stream.__enter__()
+    # The port is free again
+    with UDPInput((640, 480), port=33349) as stream:
+        start_stream(33349)
+
+        frame = stream.read(min_events=1, timeout=5.0)
+    assert numpy.equal(frame[218, 15], 1)
+
+
+def test_udp_timed_packets():
+    # Header with sequence number 0 and base time 1000, then one event 5us later
+    packet = struct.pack("<HBBIQ", 0xAE57, 1, 0, 0, 1000) + struct.pack(
+        "<IHH", 5, 218, 15 | 0x8000
+    )
+    with UDPInput((640, 480), port=33343, record_events=True) as stream:
+        start_stream(33343, packet)
+
+        stream.wait(min_events=1, timeout=5.0)
+        events = stream.read_events()
+        stats = stream.receive_stats()
+    assert list(events["timestamp"]) == [1005]
+    assert list(events["x"]) == [218]
+    assert list(events["y"]) == [15]
+    assert list(events["polarity"]) == [True]
+    assert stats.lost_packets == 0
+
+
+def test_udp_packed_packets():
+    # Packed header with base time 1000 and one event, then its row 15, the
+    # count of events in the row, column 218 with the polarity, and time 5
+    body = bytes([15, 1, 0xB5, 0x03, 5])
+    packet = (
+        struct.pack("<HBBIQ", 0xAE57, 1, 1, 0, 1000)
+        + struct.pack("<II", 1, len(body))
+        + body
+    )
+    with UDPInput((640, 480), port=33344, record_events=True) as stream:
+        start_stream(33344, packet)
+
+        stream.wait(min_events=1, timeout=5.0)
+        events = stream.read_events()
+        stats = stream.receive_stats()
+    assert list(events["timestamp"]) == [1005]
+    assert list(events["x"]) == [218]
+    assert list(events["y"]) == [15]
+    assert list(events["polarity"]) == [True]
+    assert stats.malformed_packets == 0
+
+
+def test_udp_multicast():
+    groups = ["239.0.0.45"]
+    with UDPInput((640, 480), port=33345, multicast_groups=groups) as stream:
+        start_stream(33345, host="239.0.0.45")
+
+        frame = stream.read(min_events=1, timeout=5.0)
+    assert numpy.equal(frame[218, 15], 1)
+
+
+def test_udp_multicast_threads():
+    with pytest.raises(ValueError):
+        UDPInput((640, 480), port=33346, threads=2, multicast_groups=["239.0.0.46"])
+
+
+def test_udp_read_min_events():
+    with UDPInput((640, 480), port=33338) as stream:
+        start_stream(33338)
+
+        # Blocks until the event arrives, rather than sleeping
+        frame = stream.read(min_events=1, timeout=5.0)
+    assert numpy.equal(frame[218, 15], 1)
+
+
+def test_udp_read_timeout():
+    with UDPInput((640, 480), port=33339) as stream:
+        t_0 = time.time()
+        frame = stream.read(min_events=1, timeout=0.1)
+    assert time.time() - t_0 >= 0.1
+    assert frame.sum() == 0
+
+
 @pytest.mark.skipif(not _has_cuda_torch(), reason="Torch-gpu is not installed")
 def test_udp_cuda():
     import torch
@@ -11,4 +11,12 @@ using py_size_t = std::vector<size_t>;
 
 enum Backend { GeNN, Jax, Numpy, Torch };
 
-enum Camera { Inivation, Prophesee };
\ No newline at end of file
+enum Camera { Inivation, Prophesee };
+
+enum class FrameMode { Count, Polarity, Signed, Binary, Voxel, Surface };
+
+enum class DType { Float32, UInt8, UInt16, Int16, Bool };
+
+enum class Layout { WH, HW };
+
+enum class Pooling { Sum, Any };
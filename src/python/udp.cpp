@@ -1,63 +1,278 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
+
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include "types.hpp"
 
+#include "../cpp/udp_protocol.hpp"
 #include "tensor_buffer.hpp"
 #include "udp_client.hpp"
 
+/**
+ * What a UDPInput received. Dropped packets overflowed the kernel queues
+ * before they could be read, and truncated packets did not fit the receive
+ * buffers. Lost and reordered packets are told apart by the sequence numbers
+ * of timestamped packets, so they count packets lost anywhere on the way.
+ * Malformed packets claimed to be packed but could not be decoded.
+ */
+struct UDPReceiveStats {
+  uint64_t packets = 0;
+  uint64_t events = 0;
+  uint64_t bytes = 0;
+  uint64_t dropped_packets = 0;
+  uint64_t truncated_packets = 0;
+  uint64_t lost_packets = 0;
+  uint64_t reordered_packets = 0;
+  uint64_t malformed_packets = 0;
+};
+
 class UDPInput {
 private:
-  TensorBuffer buffer;
+  // One buffer per receiving thread, merged on read
+  std::vector<std::unique_ptr<TensorBufferBase>> shards;
   const int port;
-  static const int max_events_per_packet = 256;
+  const int receive_buffer;
+  const std::vector<std::string> multicast_groups;
+  static const int max_events_per_packet = 16384;
+  // Packets read per system call, and the largest UDP payload
+  static const size_t BATCH_PACKETS = 64;
+  static const size_t MAX_PACKET_BYTES = 65536;
+  // How often receiving threads check whether to stop
+  static constexpr timeval POLL_INTERVAL = {0, 100000};
 
-  std::thread socket_thread;
+  std::vector<int> sockets;
+  std::vector<std::thread> socket_threads;
   std::atomic<bool> is_serving = {true};
 
+  std::atomic<uint64_t> packets = 0;
+  std::atomic<uint64_t> events = 0;
+  std::atomic<uint64_t> bytes = 0;
+  std::atomic<uint64_t> truncated = 0;
+  std::atomic<uint64_t> malformed = 0;
+  // Packets each socket dropped, as counted by the kernel, and the packets
+  // each socket saw lost or reordered by their sequence numbers
+  std::unique_ptr<std::atomic<uint64_t>[]> dropped;
+  std::unique_ptr<std::atomic<uint64_t>[]> lost;
+  std::unique_ptr<std::atomic<uint64_t>[]> reordered;
+
 public:
-  uint64_t count = 0;
-  UDPInput(py_size_t shape, const std::string &device, int port)
-      : buffer(shape, device, max_events_per_packet), port(port) {}
+  UDPInput(py_size_t shape, const std::string &device, int port,
+           size_t threads = 1, int receive_buffer = 0,
+           const std::vector<std::string> &multicast_groups = {},
+           const FrameOptions &options = FrameOptions())
+      : port(port), receive_buffer(receive_buffer),
+        multicast_groups(multicast_groups),
+        dropped(std::make_unique<std::atomic<uint64_t>[]>(threads)),
+        lost(std::make_unique<std::atomic<uint64_t>[]>(threads)),
+        reordered(std::make_unique<std::atomic<uint64_t>[]>(threads)) {
+    if (threads == 0) {
+      throw std::invalid_argument("UDP inputs need at least one thread");
+    }
+    if (threads > 1 && device == "cuda") {
+      throw std::invalid_argument("Sharded UDP inputs accumulate on the CPU");
+    }
+    if (threads > 1 && !multicast_groups.empty()) {
+      // Every socket on the port would receive each multicast packet
+      throw std::invalid_argument(
+          "Multicast UDP inputs receive on one thread");
+    }
+    for (size_t i = 0; i < threads; i++) {
+      shards.push_back(make_tensor_buffer(shape, device,
+                                          max_events_per_packet, options));
+      shards.back()->share_arrivals(*shards.front());
+      dropped[i].store(0);
+      lost[i].store(0);
+      reordered[i].store(0);
+    }
+  }
+
+  ~UDPInput() { stop(); }
 
   UDPInput *start_stream() {
-    std::thread socket_thread(&UDPInput::serve_synchronous, this);
-    socket_thread.detach();
+    // Bind in the caller, so failures raise in Python
+    // IPv6 groups need a socket that listens on both protocols
+    const bool dual_stack =
+        std::any_of(multicast_groups.begin(), multicast_groups.end(),
+                    [](const std::string &group) {
+                      return group.find(':') != std::string::npos;
+                    });
+    try {
+      for (size_t i = 0; i < shards.size(); i++) {
+        sockets.push_back(udp_client(std::to_string(port), shards.size() > 1,
+                                     receive_buffer, dual_stack));
+      }
+      for (const auto &group : multicast_groups) {
+        join_multicast_group(sockets[0], group);
+      }
+    } catch (...) {
+      // Let go of the port, so the input can be started again
+      for (const int sockfd : sockets) {
+        close(sockfd);
+      }
+      sockets.clear();
+      throw;
+    }
+    for (size_t i = 0; i < shards.size(); i++) {
+      socket_threads.emplace_back(&UDPInput::serve_synchronous, this, i);
+    }
     return this;
   }
 
-  std::unique_ptr<BufferPointer> read() { return buffer.read(); }
-  void read_genn(uint32_t *bitmask, size_t size){ buffer.read_genn(bitmask, size); }
-  void serve_synchronous() {
-    int sockfd;
-    int numbytes;
-    uint16_t int_buf[max_events_per_packet];
+  std::unique_ptr<BufferPointer> read() { return read_merged(shards); }
+  void read_genn(uint32_t *bitmask, size_t size) {
+    shards[0]->read_genn(bitmask, size);
+    std::vector<uint32_t> shard_bitmask(size);
+    for (size_t i = 1; i < shards.size(); i++) {
+      shards[i]->read_genn(shard_bitmask.data(), size);
+      for (size_t j = 0; j < size; j++) {
+        bitmask[j] |= shard_bitmask[j];
+      }
+    }
+  }
+  nb::dict read_events() { return TensorBufferBase::read_events(shards); }
+  nb::tuple read_sparse() { return TensorBufferBase::read_sparse(shards); }
+  bool wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+            std::optional<double> timeout) {
+    nb::gil_scoped_release release;
+    // Shards share their arrivals, so this counts the events of all of them
+    return shards[0]->wait(min_events, until_timestamp, timeout);
+  }
+
+  UDPReceiveStats stats() const {
+    UDPReceiveStats stats;
+    stats.packets = packets.load();
+    stats.bytes = bytes.load();
+    stats.events = events.load();
+    stats.truncated_packets = truncated.load();
+    stats.malformed_packets = malformed.load();
+    for (size_t i = 0; i < shards.size(); i++) {
+      stats.dropped_packets += dropped[i].load();
+      stats.lost_packets += lost[i].load();
+      stats.reordered_packets += reordered[i].load();
+    }
+    return stats;
+  }
 
-    // Connect to socket
-    struct sockaddr_storage their_addr;
-    socklen_t addr_len;
-    sockfd = udp_client(std::to_string(port));
-    addr_len = sizeof(their_addr);
+  void serve_synchronous(size_t shard) {
+    const int sockfd = sockets[shard];
+    TensorBufferBase &buffer = *shards[shard];
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &POLL_INTERVAL,
+               sizeof(POLL_INTERVAL));
+    // Have the kernel attach its count of dropped packets to each packet
+    const int enable = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
 
-    // start receiving event
+    // Left uninitialized, so only the pages packets land in are mapped
+    std::unique_ptr<uint16_t[]> data(
+        new uint16_t[BATCH_PACKETS * MAX_PACKET_BYTES / 2]);
+    constexpr size_t CONTROL_BYTES = CMSG_SPACE(sizeof(uint32_t));
+    std::vector<uint8_t> control(BATCH_PACKETS * CONTROL_BYTES);
+    std::vector<struct mmsghdr> messages(BATCH_PACKETS);
+    std::vector<struct iovec> iovecs(BATCH_PACKETS);
+    for (size_t i = 0; i < BATCH_PACKETS; i++) {
+      iovecs[i] = {data.get() + i * MAX_PACKET_BYTES / 2, MAX_PACKET_BYTES};
+      memset(&messages[i], 0, sizeof(messages[i]));
+      messages[i].msg_hdr.msg_iov = &iovecs[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Senders hash to one socket each, so each socket tracks the sequences
+    // it sees
+    SequenceTracker sequences;
+    // Events decoded from packed packets
+    std::vector<AER::Event> unpacked;
+    std::vector<uint8_t> scratch;
+
+    // start receiving events, as many packets at a time as are queued
     while (is_serving.load()) {
-      if ((numbytes = recvfrom(sockfd, int_buf, sizeof(int_buf), 0,
-                               (struct sockaddr *)&their_addr, &addr_len)) ==
-          -1) {
-        perror("recvfrom");
-        return;
+      for (size_t i = 0; i < BATCH_PACKETS; i++) {
+        messages[i].msg_hdr.msg_control = control.data() + i * CONTROL_BYTES;
+        messages[i].msg_hdr.msg_controllen = CONTROL_BYTES;
       }
-      count += numbytes / 4;
-
-      buffer.set_buffer(int_buf, numbytes);
+      const int received = recvmmsg(sockfd, messages.data(), BATCH_PACKETS,
+                                    MSG_WAITFORONE, nullptr);
+      if (received == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+          continue;
+        }
+        perror("recvmmsg");
+        break;
+      }
+      size_t received_bytes = 0;
+      size_t received_events = 0;
+      for (int i = 0; i < received; i++) {
+        const auto &header = messages[i].msg_hdr;
+        if (header.msg_flags & MSG_TRUNC) {
+          truncated++;
+        }
+        for (auto *cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&header), cmsg)) {
+          if (cmsg->cmsg_level == SOL_SOCKET &&
+              cmsg->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t count;
+            memcpy(&count, CMSG_DATA(cmsg), sizeof(count));
+            dropped[shard].store(count);
+          }
+        }
+        // Decode timestamped packets in place, packed packets into a vector,
+        // and the rest as SPIF packets
+        const auto packet =
+            TimedPacket::parse(iovecs[i].iov_base, messages[i].msg_len);
+        const auto packed =
+            packet ? std::nullopt
+                   : PackedPacket::parse(iovecs[i].iov_base,
+                                         messages[i].msg_len);
+        if (packet) {
+          sequences.receive(packet->sequence());
+          buffer.set_packet(*packet);
+          received_events += packet->size();
+        } else if (packed) {
+          sequences.receive(packed->sequence());
+          if (packed->decode(unpacked, scratch)) {
+            buffer.set_vector(unpacked);
+            received_events += unpacked.size();
+          } else {
+            malformed++;
+          }
+        } else {
+          buffer.set_buffer(static_cast<uint16_t *>(iovecs[i].iov_base),
+                            messages[i].msg_len);
+          received_events += messages[i].msg_len / 4;
+        }
+        received_bytes += messages[i].msg_len;
+      }
+      packets += received;
+      events += received_events;
+      bytes += received_bytes;
+      lost[shard].store(sequences.lost);
+      reordered[shard].store(sequences.reordered);
     }
     close(sockfd);
+    buffer.finish();
   }
 
-  void stop_stream(nb::object &a, nb::object &b, nb::object &c) {
+  void stop() {
     is_serving.store(false);
+    for (auto &shard : shards) {
+      shard->finish();
+    }
+    for (auto &thread : socket_threads) {
+      thread.join();
+    }
+    socket_threads.clear();
+  }
+
+  void stop_stream(nb::object &a, nb::object &b, nb::object &c) {
+    nb::gil_scoped_release release;
+    stop();
   }
 };
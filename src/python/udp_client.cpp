@@ -1,9 +1,15 @@
 #include <cstring>
 #include <string>
 
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
 #include "./udp_client.hpp"
 
-int udp_client(std::string port) {
+int udp_client(std::string port, bool reuse_port, int receive_buffer,
+               bool dual_stack) {
   // socket variables
   int sockfd;
   struct addrinfo hints, *servinfo, *p;
@@ -11,16 +17,15 @@ int udp_client(std::string port) {
 
   // establish connection for client
   memset(&hints, 0, sizeof hints);
-  hints.ai_family = AF_INET; // set to AF_INET to use IPv4
+  hints.ai_family = dual_stack ? AF_INET6 : AF_INET;
   hints.ai_socktype = SOCK_DGRAM;
   hints.ai_flags = AI_PASSIVE; // use my IP
 
-  const std::string ip = "0.0.0.0";
+  const std::string ip = dual_stack ? "::" : "0.0.0.0";
 
   // Get adrress-info
   if ((rv = getaddrinfo(ip.c_str(), port.c_str(), &hints, &servinfo)) != 0) {
-    fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
-    return 1;
+    throw std::runtime_error(std::string("getaddrinfo: ") + gai_strerror(rv));
   }
 
   // loop through all the results and bind to the first we can
@@ -30,6 +35,25 @@ int udp_client(std::string port) {
       continue;
     }
 
+    const int enable = 1;
+    const int disable = 0;
+    if (dual_stack && setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, &disable,
+                                 sizeof(disable)) == -1) {
+      perror("listener: IPV6_V6ONLY");
+    }
+    if (reuse_port && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &enable,
+                                 sizeof(enable)) == -1) {
+      perror("listener: SO_REUSEPORT");
+    }
+    // Raising the queue past the system limit requires privileges
+    if (receive_buffer > 0 &&
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &receive_buffer,
+                   sizeof(receive_buffer)) == -1 &&
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &receive_buffer,
+                   sizeof(receive_buffer)) == -1) {
+      perror("listener: SO_RCVBUF");
+    }
+
     if (bind(sockfd, p->ai_addr, p->ai_addrlen) == -1) {
       close(sockfd);
       perror("listener: bind");
@@ -39,11 +63,55 @@ int udp_client(std::string port) {
   }
 
   if (p == NULL) {
-    fprintf(stderr, "listener: failed to bind socket\n");
-    return 2;
+    freeaddrinfo(servinfo);
+    throw std::runtime_error("listener: failed to bind socket to port " +
+                             port);
   }
 
   freeaddrinfo(servinfo);
 
   return sockfd;
-}
\ No newline at end of file
+}
+
+void join_multicast_group(int sockfd, const std::string &group) {
+  // Link-local IPv6 groups name their interface after a %
+  const size_t percent = group.find('%');
+  const std::string address = group.substr(0, percent);
+  const unsigned interface =
+      percent == std::string::npos
+          ? 0
+          : if_nametoindex(group.substr(percent + 1).c_str());
+  if (percent != std::string::npos && interface == 0) {
+    throw std::invalid_argument("Unknown network interface in " + group);
+  }
+
+  struct in_addr ipv4;
+  struct in6_addr ipv6;
+  int result;
+  if (inet_pton(AF_INET, address.c_str(), &ipv4) == 1) {
+    if (!IN_MULTICAST(ntohl(ipv4.s_addr))) {
+      throw std::invalid_argument(group + " is not a multicast group");
+    }
+    struct ip_mreqn request;
+    memset(&request, 0, sizeof(request));
+    request.imr_multiaddr = ipv4;
+    request.imr_ifindex = interface;
+    result = setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request,
+                        sizeof(request));
+  } else if (inet_pton(AF_INET6, address.c_str(), &ipv6) == 1) {
+    if (!IN6_IS_ADDR_MULTICAST(&ipv6)) {
+      throw std::invalid_argument(group + " is not a multicast group");
+    }
+    struct ipv6_mreq request;
+    request.ipv6mr_multiaddr = ipv6;
+    request.ipv6mr_interface = interface;
+    result = setsockopt(sockfd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &request,
+                        sizeof(request));
+  } else {
+    throw std::invalid_argument(group + " is not an IP address");
+  }
+  if (result == -1) {
+    throw std::runtime_error("listener: failed to join " + group + ": " +
+                             strerror(errno));
+  }
+}
@@ -5,4 +5,16 @@
 #include <string>
 #include <unistd.h>
 
-int udp_client(std::string port);
\ No newline at end of file
+/// Opens a UDP socket bound to a port on all interfaces. Sockets opened with
+/// reuse_port share the port, and the kernel spreads packets over them. A
+/// positive receive_buffer sets the size of the kernel queue in bytes.
+/// Dual-stack sockets receive over IPv6 as well as IPv4.
+/// @throws std::runtime_error if the socket cannot be bound
+int udp_client(std::string port, bool reuse_port = false,
+               int receive_buffer = 0, bool dual_stack = false);
+
+/// Joins a socket to an IPv4 or IPv6 multicast group, such as 239.0.0.1 or
+/// ff02::1%eth0. The kernel picks the interface unless the group names one.
+/// @throws std::invalid_argument if the group is not a multicast address
+/// @throws std::runtime_error if the socket cannot join the group
+void join_multicast_group(int sockfd, const std::string &group);
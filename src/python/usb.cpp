@@ -16,9 +16,8 @@ private:
   Generator<AER::Event> generator;
   std::thread socket_thread;
   static const uint32_t EVENT_BUFFER_SIZE = 64;
-  TensorBuffer buffer;
+  std::unique_ptr<TensorBufferBase> buffer;
   std::atomic<bool> is_streaming = {true};
-  std::atomic<bool> done_streaming = {false};
 
   void stream_synchronous() {
     while (is_streaming.load()) {
@@ -29,18 +28,20 @@ private:
         local_buffer.push_back(event);
 
         if (local_buffer.size() >= EVENT_BUFFER_SIZE) {
-          buffer.set_vector(local_buffer);
+          buffer->set_vector(local_buffer);
           local_buffer.clear();
         }
       }
     }
-    done_streaming.store(true);
+    buffer->finish();
   };
 
 public:
   // General constructor
-  USBInput(py_size_t shape, const std::string device, Camera camera)
-      : buffer(shape, device, EVENT_BUFFER_SIZE) {
+  USBInput(py_size_t shape, const std::string device, Camera camera,
+           const FrameOptions &options = FrameOptions())
+      : buffer(
+            make_tensor_buffer(shape, device, EVENT_BUFFER_SIZE, options)) {
     if (camera == Camera::Inivation) {
 #ifdef WITH_CAER
       generator = inivation_event_generator({}, is_streaming);
@@ -58,8 +59,10 @@ public:
 // Inivation via LIBCAER
 #ifdef WITH_CAER
   USBInput(py_size_t shape, const std::string device, uint16_t deviceId,
-           uint16_t deviceAddress)
-      : buffer(shape, device, EVENT_BUFFER_SIZE) {
+           uint16_t deviceAddress,
+           const FrameOptions &options = FrameOptions())
+      : buffer(
+            make_tensor_buffer(shape, device, EVENT_BUFFER_SIZE, options)) {
     if (deviceId > 0) {
       try {
         auto address = InivationDeviceAddress{"dvx", deviceId, deviceAddress};
@@ -75,29 +78,46 @@ public:
 #endif
 // Prophesee via Metavision
 #ifdef WITH_METAVISION
-  USBInput(py_size_t shape, const std::string device, const std::string serial)
-      : buffer(shape, device, EVENT_BUFFER_SIZE) {
+  USBInput(py_size_t shape, const std::string device, const std::string serial,
+           const FrameOptions &options = FrameOptions())
+      : buffer(
+            make_tensor_buffer(shape, device, EVENT_BUFFER_SIZE, options)) {
         std::cout << serial << std::endl;
     generator = prophesee_event_generator(is_streaming, serial);
   }
 #endif
 
-  std::unique_ptr<BufferPointer> read() { return buffer.read(); }
+  std::unique_ptr<BufferPointer> read() { return buffer->read(); }
   void read_genn(uint32_t *bitmask, size_t size) {
-    buffer.read_genn(bitmask, size);
+    buffer->read_genn(bitmask, size);
+  }
+  nb::dict read_events() { return buffer->read_events(); }
+  nb::tuple read_sparse() { return buffer->read_sparse(); }
+  bool wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+            std::optional<double> timeout) {
+    nb::gil_scoped_release release;
+    return buffer->wait(min_events, until_timestamp, timeout);
   }
 
   USBInput *start_stream() {
-    std::thread socket_thread(&USBInput::stream_synchronous, this);
-    socket_thread.detach();
+    socket_thread = std::thread(&USBInput::stream_synchronous, this);
     return this;
   }
 
   void stop_stream() {
     is_streaming.store(false);
-    while (!done_streaming.load()) {
-      // Wait until the thread is done streaming to avoid freeing memory too
-      // early
+    // Wait until the thread is done streaming to avoid freeing memory too
+    // early, without holding the GIL the camera callbacks may need
+    if (socket_thread.joinable()) {
+      nb::gil_scoped_release release;
+      socket_thread.join();
+    }
+  }
+
+  ~USBInput() {
+    is_streaming.store(false);
+    if (socket_thread.joinable()) {
+      socket_thread.join();
     }
   }
 };
@@ -1,53 +1,78 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <span>
+#include <thread>
+
 #include "input/zmq.hpp"
 #include "types.hpp"
 #include "tensor_buffer.hpp"
 
 struct ZMQInput {
 
-  ZMQInput(py_size_t shape, const std::string& device, const std::string& address)
-      : buffer(shape, device, EVENT_BUFFER_SIZE), address(address) {
+  ZMQInput(py_size_t shape, const std::string& device, const std::string& address,
+           const FrameOptions& options = FrameOptions())
+      : buffer(make_tensor_buffer(shape, device, BATCH_EVENTS, options)), address(address) {
   }
 
-  std::unique_ptr<BufferPointer> read() { 
-    return buffer.read(); 
+  ~ZMQInput() { stop(); }
+
+  std::unique_ptr<BufferPointer> read() {
+    return buffer->read();
+  }
+  void read_genn(uint32_t *bitmask, size_t size){ buffer->read_genn(bitmask, size); }
+  nb::dict read_events() { return buffer->read_events(); }
+  nb::tuple read_sparse() { return buffer->read_sparse(); }
+  bool wait(size_t min_events, std::optional<uint64_t> until_timestamp,
+            std::optional<double> timeout) {
+    nb::gil_scoped_release release;
+    return buffer->wait(min_events, until_timestamp, timeout);
   }
-  void read_genn(uint32_t *bitmask, size_t size){ buffer.read_genn(bitmask, size); }
 
   ZMQInput *start_stream() {
-    generator = open_zmq(address, is_streaming);
-    std::thread socket_thread(&ZMQInput::stream_synchronous, this);
-    socket_thread.detach();
+    // Connect in the caller, so failures raise in Python
+    reader = std::make_unique<ZMQReader>(address);
+    socket_thread = std::thread(&ZMQInput::stream_synchronous, this);
     return this;
   }
 
   void stop_stream() {
-    is_streaming.store(false);
+    nb::gil_scoped_release release;
+    stop();
   }
 
 private:
+  std::unique_ptr<TensorBufferBase> buffer;
   const std::string address;
-  Generator<AER::Event> generator;
-  TensorBuffer buffer;
+  std::unique_ptr<ZMQReader> reader;
+  std::thread socket_thread;
   std::atomic<bool> is_streaming = {true};
-  static const uint32_t EVENT_BUFFER_SIZE = 64;
+  // Events handed to the buffer at a time, which bounds its device buffers
+  static const size_t BATCH_EVENTS = 65536;
+
+  void stop() {
+    is_streaming.store(false);
+    buffer->finish();
+    if (socket_thread.joinable()) {
+      socket_thread.join();
+    }
+  }
 
+  // Hands the events of each message to the buffer where they lie, rather
+  // than one by one
   void stream_synchronous() {
+    std::span<const AER::Event> events;
     while (is_streaming.load()) {
-      // We add a local buffer to avoid overusing the atomic lock in the actual
-      // buffer
-      std::vector<AER::Event> local_buffer = {};
-      for (auto event : generator) {
-        if (event.x > buffer.shape[0] || event.y > buffer.shape[1]) {
-          continue;
-        }
-        local_buffer.push_back(event);
-
-        if (local_buffer.size() >= EVENT_BUFFER_SIZE) {
-          buffer.set_vector(local_buffer);
-          local_buffer.clear();
-        }
+      // Wake up now and then to see whether to stop
+      if (!reader->read(events, std::chrono::milliseconds(100))) {
+        continue;
+      }
+      for (size_t start = 0; start < events.size(); start += BATCH_EVENTS) {
+        buffer->set_events(events.subspan(
+            start, std::min(BATCH_EVENTS, events.size() - start)));
       }
     }
-    is_streaming.store(false);
+    buffer->finish();
   };
-};
\ No newline at end of file
+};
@@ -18,6 +18,13 @@ TEST(FileTest, ReadCSVFile) {
   ASSERT_EQ(size, expected);
   ASSERT_EQ(events[99].timestamp, 99);
 }
+TEST(FileTest, ReadCSVFileAfterEnd) {
+  auto file = open_event_file("example/sample.csv");
+  file->read_events(-1);
+  auto [events, size] = file->read_events(-1);
+  ASSERT_EQ(size, 0);
+  ASSERT_EQ(events.capacity(), 0);
+}
 TEST(FileTest, ReadDATFile) {
   auto file = open_event_file("example/sample.dat");
   auto [events, size] = file->read_events(-1);
@@ -90,6 +97,55 @@ TEST(FileTest, ReadAEDAT4FileParts) {
   const size_t expected2 = 117667 - 10000;
   ASSERT_EQ(size2, expected2);
 }
+TEST(FileTest, CountCSVFile) {
+  auto file = open_event_file("example/sample.csv");
+  ASSERT_EQ(file->count_events(), 100);
+}
+TEST(FileTest, CountDATFile) {
+  auto file = open_event_file("example/sample.dat");
+  ASSERT_EQ(file->count_events(), 539481);
+}
+TEST(FileTest, CountEVT3File) {
+  auto file = open_event_file("example/sample.raw");
+  ASSERT_EQ(file->count_events(), 1757180);
+  auto [events, size] = file->read_events(-1);
+  ASSERT_EQ(events.capacity(), size);
+}
+TEST(FileTest, CountEVT3FileParts) {
+  auto file = open_event_file("example/sample.raw");
+  auto [events1, size1] = file->read_events(37000);
+  auto [events2, size2] = file->read_events(-1);
+  ASSERT_EQ(size1 + size2, 1757180);
+  ASSERT_EQ(events2.capacity(), size2);
+}
+TEST(FileTest, CountAEDAT4File) {
+  auto file = open_event_file("example/sample.aedat4");
+  ASSERT_EQ(file->count_events(), 117667);
+}
+TEST(FileTest, ReadIntoDATFile) {
+  auto file = open_event_file("example/sample.dat");
+  std::vector<AER::Event> events(10000);
+  ASSERT_EQ(file->read_into(events), 10000);
+  ASSERT_EQ(events[0].x, 237);
+  ASSERT_EQ(events[0].y, 121);
+  std::vector<AER::Event> rest(539481);
+  ASSERT_EQ(file->read_into(rest), 539481 - 10000);
+}
+TEST(FileTest, ReadIntoColumnsEVT3File) {
+  auto file = open_event_file("example/sample.raw");
+  const size_t size = 37000;
+  std::vector<uint64_t> timestamp(size);
+  std::vector<uint16_t> x(size), y(size);
+  auto polarity = std::make_unique<bool[]>(size);
+  const EventColumns columns = {timestamp, x, y,
+                                std::span(polarity.get(), size)};
+  ASSERT_EQ(file->read_into(columns), size);
+  ASSERT_EQ(x[0], 891);
+  ASSERT_EQ(y[0], 415);
+  ASSERT_EQ(x[36999], 660);
+  ASSERT_EQ(y[36999], 285);
+  ASSERT_EQ(polarity[36999], 1);
+}
 TEST(FileTest, StreamAEDAT4File) {
   auto handle = open_event_file("example/sample.aedat4");
   auto generator = handle->stream();
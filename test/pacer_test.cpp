@@ -0,0 +1,56 @@
+#include <chrono>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "pacer.hpp"
+
+Generator<AER::Event> events_every(uint64_t step, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    co_yield AER::Event{1000 + i * step, 1, 2, true};
+  }
+}
+
+TEST(PacerTest, FailSpeedOutOfRange) {
+  EXPECT_THROW(Pacer(0.01), std::invalid_argument);
+  EXPECT_THROW(Pacer(1000), std::invalid_argument);
+}
+
+TEST(PacerTest, PaceEventsAtSpeed) {
+  // 20ms of events played back at twice the speed
+  Pacer pacer(2);
+  auto events = events_every(10, 2001);
+  const auto start = std::chrono::steady_clock::now();
+  size_t count = 0;
+  for ([[maybe_unused]] auto event : pace_events(events, pacer)) {
+    count++;
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(count, 2001);
+  // Pacing starts at the end of the first batch, 990us into the events
+  ASSERT_GE(elapsed, std::chrono::microseconds(9505));
+  const auto stats = pacer.stats();
+  ASSERT_EQ(stats.batches, 21);
+}
+
+TEST(PacerTest, TokenBucketLimitsRate) {
+  // Bursts of 100 tokens, refilled at 100000 per second
+  TokenBucket bucket(100000, 100);
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 20; i++) {
+    wait_until(bucket.ready_at(50));
+    bucket.take(50);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  // The first two takes spend the burst, and the others wait 500us each
+  ASSERT_GE(elapsed, std::chrono::microseconds(9000));
+  ASSERT_LT(elapsed, std::chrono::milliseconds(50));
+}
+
+TEST(PacerTest, TokenBucketWithoutLimit) {
+  TokenBucket bucket(0, 0);
+  bucket.take(1000);
+  const auto ready = bucket.ready_at(1000);
+  ASSERT_LE(ready, std::chrono::steady_clock::now());
+  EXPECT_THROW(TokenBucket(-1, 1), std::invalid_argument);
+}
@@ -0,0 +1,44 @@
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "region.hpp"
+
+Generator<AER::Event> events_at(std::vector<AER::Event> events) {
+  for (auto event : events) {
+    co_yield event;
+  }
+}
+
+TEST(RegionTest, FailEmptyRegion) {
+  EXPECT_THROW(Region(0, 0, 0, 10), std::invalid_argument);
+  EXPECT_THROW(Region(0, 0, 10, 10, 0), std::invalid_argument);
+}
+
+TEST(RegionTest, ScaledSizeRoundsUp) {
+  const Region region(10, 20, 9, 8, 4);
+  ASSERT_EQ(region.scaled_width(), 3);
+  ASSERT_EQ(region.scaled_height(), 2);
+}
+
+TEST(RegionTest, CropAndDownsampleEvents) {
+  auto events = events_at({{1, 10, 20, true},
+                           {2, 9, 20, true},
+                           {3, 13, 27, false},
+                           {4, 18, 20, true},
+                           {5, 17, 28, true}});
+  const Region region(10, 20, 8, 8, 4);
+  std::vector<AER::Event> cropped;
+  for (auto event : crop_events(events, region)) {
+    cropped.push_back(event);
+  }
+  ASSERT_EQ(cropped.size(), 2);
+  EXPECT_EQ(cropped[0].timestamp, 1);
+  EXPECT_EQ(cropped[0].x, 0);
+  EXPECT_EQ(cropped[0].y, 0);
+  EXPECT_EQ(cropped[1].timestamp, 3);
+  EXPECT_EQ(cropped[1].x, 0);
+  EXPECT_EQ(cropped[1].y, 1);
+  EXPECT_FALSE(cropped[1].polarity);
+}
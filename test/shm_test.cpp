@@ -0,0 +1,84 @@
+#include <chrono>
+#include <span>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "input/shm.hpp"
+#include "output/dvs_to_shm.hpp"
+
+using namespace std::chrono_literals;
+
+std::string ring_name(const std::string &test) {
+  return "aestream_test_" + test + "_" + std::to_string(getpid());
+}
+
+void publish_batch(DVSToShm<AER::Event> &ring, uint64_t first,
+                   uint32_t count) {
+  AER::Event *events = ring.claim();
+  for (uint32_t i = 0; i < count; i++) {
+    events[i] = {first + i, static_cast<uint16_t>(i), 2, true};
+  }
+  ring.publish(count);
+}
+
+TEST(ShmRingTest, ReadBatchesInPlace) {
+  DVSToShm<AER::Event> ring(ring_name("read"), 4, 16);
+  ShmRingReader reader(ring_name("read"));
+  std::span<const AER::Event> events;
+  ASSERT_EQ(reader.next(events, 1ms), ShmRingReader::Status::Timeout);
+
+  publish_batch(ring, 100, 16);
+  publish_batch(ring, 200, 3);
+  ASSERT_EQ(reader.lag(), 2);
+  ASSERT_EQ(reader.next(events, 1s), ShmRingReader::Status::Batch);
+  ASSERT_EQ(events.size(), 16);
+  ASSERT_EQ(events[15].timestamp, 115);
+  ASSERT_TRUE(reader.intact());
+  ASSERT_EQ(reader.next(events, 1s), ShmRingReader::Status::Batch);
+  ASSERT_EQ(events.size(), 3);
+  ASSERT_EQ(events[0].timestamp, 200);
+  ASSERT_EQ(reader.lag(), 0);
+
+  const auto stats = ring.stats();
+  ASSERT_EQ(stats.batches, 2);
+  ASSERT_EQ(stats.events, 19);
+  ASSERT_EQ(stats.consumers.size(), 1);
+  ASSERT_EQ(stats.consumers[0].pid, getpid());
+  ASSERT_EQ(stats.consumers[0].lag, 0);
+}
+
+TEST(ShmRingTest, SlowReaderSkipsAhead) {
+  DVSToShm<AER::Event> ring(ring_name("slow"), 4, 8);
+  ShmRingReader reader(ring_name("slow"));
+  for (uint64_t batch = 0; batch < 10; batch++) {
+    publish_batch(ring, batch * 100, 8);
+  }
+  ASSERT_EQ(ring.stats().consumers[0].lag, 10);
+
+  // Readers stay a slot clear of the producer, so the 3 latest remain
+  std::span<const AER::Event> events;
+  ASSERT_EQ(reader.next(events, 1s), ShmRingReader::Status::Batch);
+  ASSERT_EQ(events[0].timestamp, 700);
+  ASSERT_EQ(reader.lost_batches(), 7);
+
+  // The batch being read is overwritten after the producer comes around
+  publish_batch(ring, 1000, 8);
+  ASSERT_TRUE(reader.intact());
+  publish_batch(ring, 1100, 8);
+  ASSERT_FALSE(reader.intact());
+  ASSERT_EQ(reader.torn_batches(), 1);
+}
+
+TEST(ShmRingTest, CloseEndsReaders) {
+  auto ring = std::make_unique<DVSToShm<AER::Event>>(ring_name("close"), 4, 8);
+  ShmRingReader reader(ring_name("close"));
+  publish_batch(*ring, 0, 8);
+  ring.reset();
+
+  // Batches published before closing are still read
+  std::span<const AER::Event> events;
+  ASSERT_EQ(reader.next(events, 1s), ShmRingReader::Status::Batch);
+  ASSERT_EQ(reader.next(events, 1s), ShmRingReader::Status::Closed);
+  ASSERT_THROW(ShmRingReader(ring_name("close")), std::runtime_error);
+}
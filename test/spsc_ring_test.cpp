@@ -0,0 +1,132 @@
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "aer.hpp"
+#include "spsc_ring.hpp"
+
+// Event of a camera driver, which the callback converts
+struct FakeCameraEvent {
+  uint16_t x, y;
+  int16_t p;
+  int64_t t;
+};
+
+// Calls back with buffers of events from its own thread, like the Metavision
+// SDK, and overwrites each buffer once the callback returns
+class FakeCamera {
+public:
+  using Callback =
+      std::function<void(const FakeCameraEvent *, const FakeCameraEvent *)>;
+
+  void run(const Callback &callback, size_t buffers, size_t buffer_size) {
+    thread = std::thread([=]() {
+      std::vector<FakeCameraEvent> buffer(buffer_size);
+      int64_t time = 0;
+      for (size_t i = 0; i < buffers; i++) {
+        for (auto &event : buffer) {
+          event = {uint16_t(time % 640), uint16_t(time % 480),
+                   int16_t(time % 2), time};
+          time++;
+        }
+        callback(buffer.data(), buffer.data() + buffer.size());
+      }
+    });
+  }
+  void join() { thread.join(); }
+
+private:
+  std::thread thread;
+};
+
+AER::Event convert(const FakeCameraEvent &event) {
+  return {uint64_t(event.t), event.x, event.y, bool(event.p)};
+}
+
+TEST(SpscRingTest, CopyBuffersFromCallbacks) {
+  SpscRing<AER::Event> ring(1 << 16);
+  FakeCamera camera;
+  camera.run(
+      [&ring](const FakeCameraEvent *begin, const FakeCameraEvent *end) {
+        ring.push(begin, end, convert);
+      },
+      1000, 100);
+
+  std::vector<AER::Event> batch;
+  uint64_t received = 0;
+  uint64_t next_timestamp = 0;
+  while (received + ring.dropped() < 100000) {
+    ring.pop(batch, 4096, std::chrono::seconds(5));
+    ASSERT_FALSE(batch.empty());
+    for (const AER::Event event : batch) {
+      // Drops leave gaps, but events stay in order and whole
+      ASSERT_GE(event.timestamp, next_timestamp);
+      ASSERT_EQ(event.x, event.timestamp % 640);
+      ASSERT_EQ(event.y, event.timestamp % 480);
+      ASSERT_EQ(event.polarity, event.timestamp % 2 == 1);
+      next_timestamp = event.timestamp + 1;
+    }
+    received += batch.size();
+  }
+  camera.join();
+  ASSERT_EQ(received, ring.pushed());
+  ASSERT_EQ(ring.pushed() + ring.dropped(), 100000);
+}
+
+TEST(SpscRingTest, DropWhatDoesNotFit) {
+  SpscRing<AER::Event> ring(200);
+  ASSERT_EQ(ring.capacity, 256);
+  std::vector<AER::Event> events(100);
+  for (size_t i = 0; i < events.size(); i++) {
+    events[i] = {i, 1, 2, true};
+  }
+  ASSERT_EQ(ring.push(events), 100);
+  ASSERT_EQ(ring.push(events), 100);
+  ASSERT_EQ(ring.push(events), 56);
+  ASSERT_EQ(ring.push(events), 0);
+  ASSERT_EQ(ring.pushed(), 256);
+  ASSERT_EQ(ring.dropped(), 144);
+  ASSERT_EQ(ring.dropped_batches(), 2);
+
+  std::vector<AER::Event> batch;
+  ASSERT_EQ(ring.pop(batch, 1000, std::chrono::seconds(0)), 256);
+  ASSERT_EQ(batch[0].timestamp, 0);
+  ASSERT_EQ(batch[199].timestamp, 99);
+  ASSERT_EQ(batch[255].timestamp, 55);
+  // Room again once read
+  ASSERT_EQ(ring.push(events), 100);
+}
+
+TEST(SpscRingTest, SleepUntilWoken) {
+  SpscRing<AER::Event> ring(1024);
+  std::vector<AER::Event> batch;
+  // Times out on an empty ring
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(ring.pop(batch, 1024, std::chrono::milliseconds(20)), 0);
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(20));
+
+  // Wakes as soon as events arrive, long before the timeout
+  std::thread producer([&ring]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<AER::Event> events(10, AER::Event{1, 2, 3, true});
+    ring.push(events);
+  });
+  const auto wait_start = std::chrono::steady_clock::now();
+  ASSERT_EQ(ring.pop(batch, 1024, std::chrono::seconds(10)), 10);
+  ASSERT_LT(std::chrono::steady_clock::now() - wait_start,
+            std::chrono::seconds(5));
+  producer.join();
+
+  // And when closed
+  std::thread closer([&ring]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ring.close();
+  });
+  ASSERT_EQ(ring.pop(batch, 1024, std::chrono::seconds(10)), 0);
+  ASSERT_TRUE(ring.closed());
+  closer.join();
+}
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "input/stream.hpp"
+#include "output/dvs_to_stream.hpp"
+
+Generator<AER::Event> counting_events(size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    co_yield AER::Event{1000 + i, static_cast<uint16_t>(i % 640),
+                        static_cast<uint16_t>(i % 480), i % 2 == 0};
+  }
+}
+
+TEST(StreamTest, FramesRoundTrip) {
+  int sockets[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+  {
+    DVSToStream<AER::Event> output(sockets[0], 100);
+    auto events = counting_events(250);
+    output.stream(events);
+    const auto stats = output.stats();
+    ASSERT_EQ(stats.events, 250);
+    ASSERT_EQ(stats.frames, 3);
+    ASSERT_EQ(stats.bytes, 3 * sizeof(StreamFrameHeader) + 250 * 13);
+  }
+
+  // Read the frames in batches smaller than the frames
+  const std::atomic<bool> running = true;
+  FrameReader reader(sockets[1], 64);
+  std::vector<AER::Event> events;
+  size_t received = 0;
+  while (reader.read(events, running)) {
+    ASSERT_LE(events.size(), 64);
+    for (const auto &event : events) {
+      ASSERT_EQ(event.timestamp, 1000 + received);
+      ASSERT_EQ(event.x, received % 640);
+      ASSERT_EQ(event.polarity, received % 2 == 0);
+      received++;
+    }
+  }
+  ASSERT_EQ(received, 250);
+  ASSERT_EQ(reader.frames(), 3);
+  close(sockets[1]);
+}
+
+TEST(StreamTest, RejectMalformedFrame) {
+  int sockets[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+  const StreamFrameHeader header{0x12345678, 1};
+  ASSERT_EQ(write(sockets[0], &header, sizeof(header)), sizeof(header));
+  close(sockets[0]);
+
+  const std::atomic<bool> running = true;
+  FrameReader reader(sockets[1]);
+  std::vector<AER::Event> events;
+  ASSERT_THROW(reader.read(events, running), std::runtime_error);
+  close(sockets[1]);
+}
+
+TEST(StreamTest, RejectTruncatedFrame) {
+  int sockets[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+  const StreamFrameHeader header{StreamFrameHeader::MAGIC, 2};
+  const AER::Event event{1000, 1, 2, true};
+  ASSERT_EQ(write(sockets[0], &header, sizeof(header)), sizeof(header));
+  ASSERT_EQ(write(sockets[0], &event, sizeof(event)), sizeof(event));
+  close(sockets[0]);
+
+  const std::atomic<bool> running = true;
+  FrameReader reader(sockets[1]);
+  std::vector<AER::Event> events;
+  ASSERT_THROW(reader.read(events, running), std::runtime_error);
+  close(sockets[1]);
+}
@@ -0,0 +1,73 @@
+// Compares the bytes each UDP encoding puts on the wire per event with the
+// time it takes to code them, on a synthetic stream of a moving edge
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "udp_protocol.hpp"
+
+std::vector<AER::Event> edge_events(size_t count, double events_per_us) {
+  std::mt19937 random(42);
+  std::normal_distribution<double> jitter(0, 2);
+  std::exponential_distribution<double> interval(events_per_us);
+  std::vector<AER::Event> events;
+  double time = 0;
+  for (size_t i = 0; i < count; i++) {
+    time += interval(random);
+    // A vertical edge crossing a 640x480 sensor every 10ms
+    const double edge = std::fmod(time / 10000 * 640, 640);
+    const int x = std::clamp<int>(edge + jitter(random), 0, 639);
+    events.push_back({static_cast<uint64_t>(time), static_cast<uint16_t>(x),
+                      static_cast<uint16_t>(random() % 480),
+                      static_cast<bool>(random() & 1)});
+  }
+  return events;
+}
+
+void benchmark(const std::vector<AER::Event> &events, size_t packet_size,
+               bool lz4) {
+  std::vector<uint8_t> packet(PackedPacket::max_bytes(packet_size));
+  std::vector<uint8_t> scratch;
+  std::vector<AER::Event> pending, received;
+  size_t bytes = 0;
+  std::chrono::duration<double, std::nano> encoding{0}, decoding{0};
+  for (size_t start = 0; start < events.size(); start += packet_size) {
+    const size_t end = std::min(events.size(), start + packet_size);
+    pending.assign(events.begin() + start, events.begin() + end);
+
+    const auto begin = std::chrono::steady_clock::now();
+    const size_t packet_bytes =
+        PackedPacket::encode(pending, 0, lz4, packet.data(), scratch);
+    const auto encoded = std::chrono::steady_clock::now();
+    PackedPacket::parse(packet.data(), packet_bytes)->decode(received, scratch);
+    const auto decoded = std::chrono::steady_clock::now();
+
+    bytes += packet_bytes;
+    encoding += encoded - begin;
+    decoding += decoded - encoded;
+  }
+  printf("%-10s %6zu %12.2f %12.1f %12.1f\n", lz4 ? "packed+lz4" : "packed",
+         packet_size, double(bytes) / events.size(),
+         encoding.count() / events.size(), decoding.count() / events.size());
+}
+
+int main() {
+  for (const double rate : {0.1, 1.0, 10.0}) {
+    const auto events = edge_events(1000000, rate);
+    printf("%.1f events/us\n", rate);
+    printf("%-10s %6s %12s %12s %12s\n", "encoding", "events", "bytes/event",
+           "encode ns", "decode ns");
+    for (const size_t packet_size : {128, 1024, 3000}) {
+      printf("%-10s %6zu %12.2f\n", "spif", packet_size, 4.0);
+      printf("%-10s %6zu %12.2f\n", "timed", packet_size,
+             double(sizeof(TimedPacketHeader)) / packet_size +
+                 sizeof(TimedEvent));
+      benchmark(events, packet_size, false);
+      benchmark(events, packet_size, true);
+    }
+  }
+  return 0;
+}
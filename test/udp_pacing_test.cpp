@@ -0,0 +1,50 @@
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "output/udp_pacing.hpp"
+
+void push_packets(PacketQueue &queue, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    queue.push(&i, 1, 10);
+  }
+}
+
+TEST(PacketQueueTest, FailEmptyQueue) {
+  EXPECT_THROW(PacketQueue(0, OverflowPolicy::Block), std::invalid_argument);
+}
+
+TEST(PacketQueueTest, DropNewestPackets) {
+  PacketQueue queue(3, OverflowPolicy::DropNewest);
+  push_packets(queue, 5);
+  std::vector<QueuedPacket> packets;
+  ASSERT_TRUE(queue.pop(packets, 10));
+  ASSERT_EQ(packets.size(), 3);
+  ASSERT_EQ(packets.front().data[0], 0);
+  ASSERT_EQ(packets.back().data[0], 2);
+  ASSERT_EQ(queue.dropped_packets(), 2);
+  ASSERT_EQ(queue.dropped_events(), 20);
+}
+
+TEST(PacketQueueTest, DropOldestPackets) {
+  PacketQueue queue(3, OverflowPolicy::DropOldest);
+  push_packets(queue, 5);
+  std::vector<QueuedPacket> packets;
+  ASSERT_TRUE(queue.pop(packets, 2));
+  ASSERT_EQ(packets.size(), 2);
+  ASSERT_EQ(packets.front().data[0], 2);
+  ASSERT_EQ(queue.dropped_packets(), 2);
+}
+
+TEST(PacketQueueTest, DrainAfterClose) {
+  PacketQueue queue(3, OverflowPolicy::Block);
+  push_packets(queue, 2);
+  queue.close();
+  uint8_t late = 9;
+  ASSERT_FALSE(queue.push(&late, 1, 1));
+  std::vector<QueuedPacket> packets;
+  ASSERT_TRUE(queue.pop(packets, 10));
+  ASSERT_EQ(packets.size(), 2);
+  ASSERT_FALSE(queue.pop(packets, 10));
+}
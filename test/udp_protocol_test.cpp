@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "udp_protocol.hpp"
+
+std::vector<AER::Event> sample_events(size_t count) {
+  std::vector<AER::Event> events;
+  for (size_t i = 0; i < count; i++) {
+    events.push_back({1000 + i * 3, static_cast<uint16_t>((i * 37) % 640),
+                      static_cast<uint16_t>((i * 11) % 480), i % 3 == 0});
+  }
+  return events;
+}
+
+void expect_round_trip(bool lz4) {
+  const auto sent = sample_events(500);
+  auto events = sent;
+  std::vector<uint8_t> packet(PackedPacket::max_bytes(events.size()));
+  std::vector<uint8_t> scratch;
+  const size_t bytes =
+      PackedPacket::encode(events, 7, lz4, packet.data(), scratch);
+  ASSERT_LT(bytes, events.size() * sizeof(TimedEvent));
+  ASSERT_FALSE(TimedPacket::parse(packet.data(), bytes));
+
+  const auto packed = PackedPacket::parse(packet.data(), bytes);
+  ASSERT_TRUE(packed);
+  ASSERT_EQ(packed->sequence(), 7);
+  ASSERT_EQ(packed->size(), sent.size());
+  std::vector<AER::Event> received;
+  ASSERT_TRUE(packed->decode(received, scratch));
+  ASSERT_EQ(received.back().timestamp, sent.back().timestamp);
+
+  auto by_time = [](const AER::Event &a, const AER::Event &b) {
+    return a.timestamp < b.timestamp;
+  };
+  std::sort(received.begin(), received.end(), by_time);
+  for (size_t i = 0; i < sent.size(); i++) {
+    ASSERT_EQ(received[i].timestamp, sent[i].timestamp);
+    ASSERT_EQ(received[i].x, sent[i].x);
+    ASSERT_EQ(received[i].y, sent[i].y);
+    ASSERT_EQ(received[i].polarity, sent[i].polarity);
+  }
+}
+
+TEST(PackedPacketTest, RoundTrip) { expect_round_trip(false); }
+
+TEST(PackedPacketTest, RoundTripLZ4) { expect_round_trip(true); }
+
+TEST(PackedPacketTest, RejectSPIFPacket) {
+  // SPIF words whose y and low byte of x match the magic and version
+  const uint32_t word = ((0x0001u | 0x8000u) << 16) | TimedPacketHeader::MAGIC;
+  std::vector<uint32_t> packet(6, word);
+  const size_t bytes = packet.size() * sizeof(uint32_t);
+  ASSERT_FALSE(TimedPacket::parse(packet.data(), bytes));
+  ASSERT_FALSE(PackedPacket::parse(packet.data(), bytes));
+}
+
+TEST(PackedPacketTest, RejectUnknownFlags) {
+  auto events = sample_events(10);
+  std::vector<uint8_t> packet(PackedPacket::max_bytes(events.size()));
+  std::vector<uint8_t> scratch;
+  const size_t bytes =
+      PackedPacket::encode(events, 0, false, packet.data(), scratch);
+  reinterpret_cast<TimedPacketHeader *>(packet.data())->flags |= 0x4;
+  ASSERT_FALSE(PackedPacket::parse(packet.data(), bytes));
+}
+
+TEST(PackedPacketTest, RejectTruncatedPacket) {
+  auto events = sample_events(100);
+  std::vector<uint8_t> packet(PackedPacket::max_bytes(events.size()));
+  std::vector<uint8_t> scratch;
+  const size_t bytes =
+      PackedPacket::encode(events, 0, false, packet.data(), scratch);
+  std::vector<AER::Event> received;
+  const auto packed = PackedPacket::parse(packet.data(), bytes - 1);
+  ASSERT_TRUE(packed);
+  ASSERT_FALSE(packed->decode(received, scratch));
+}